@@ -0,0 +1,159 @@
+// Compares the GPU counter instance-name parsing used by PdhProcessSampler
+// against the previous std::stringstream based tokenizer.
+
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include <core/sampler/GpuInstanceName.hpp>
+
+constexpr size_t kNameCount = 10'000;
+constexpr int kIterations = 50;
+
+static const char* kEngineTypes[] = { "3D", "Copy", "VideoDecode", "VideoEncode", "Compute_0", "Compute_1", "Security", "LegacyOverlay" };
+
+struct LegacyInstanceKey {
+    uint32_t pid;
+    uint32_t luid_low;
+    uint32_t luid_high;
+    uint32_t gpu_index;
+    uint32_t engine_index;
+    std::string engine_type;
+};
+
+// Previous implementation from TaskMonitor::calculateGpuMetricFromCounter, kept as the baseline.
+static auto legacyParse(const std::string& name, LegacyInstanceKey& key) -> void
+{
+    std::stringstream stream(name);
+    std::string token;
+    std::vector<std::string> tokens;
+
+    while (std::getline(stream, token, '_'))
+        tokens.push_back(token);
+
+    key = {};
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == "pid") {
+            key.pid = std::stoul(tokens[++i]);
+        }
+        else if (tokens[i] == "luid") {
+            key.luid_high = static_cast<uint32_t>(std::stoull(tokens[++i], nullptr, 16));
+            key.luid_low = static_cast<uint32_t>(std::stoul(tokens[++i], nullptr, 16));
+        }
+        else if (tokens[i] == "phys") {
+            key.gpu_index = std::stoi(tokens[++i]);
+        }
+        else if (tokens[i] == "eng") {
+            key.engine_index = std::stoi(tokens[++i]);
+        }
+        else if (tokens[i] == "engtype") {
+            key.engine_type = tokens[++i];
+        }
+    }
+}
+
+static auto generateNames() -> std::vector<std::string>
+{
+    std::mt19937 rng(1337);
+    std::uniform_int_distribution<uint32_t> pid_dist(4, 65'535);
+    std::uniform_int_distribution<uint32_t> engine_dist(0, 15);
+
+    std::vector<std::string> names;
+    names.reserve(kNameCount);
+
+    char name[128] = {};
+    for (size_t i = 0; i < kNameCount; ++i) {
+        const uint32_t pid = pid_dist(rng);
+        const uint32_t engine = engine_dist(rng);
+
+        // Roughly one in ten instances comes from "GPU Process Memory", the rest from "GPU Engine".
+        if (i % 10 == 0)
+            snprintf(name, sizeof(name), "pid_%u_luid_0x00000000_0x0000D1A2_phys_0", pid);
+        else
+            snprintf(name, sizeof(name), "pid_%u_luid_0x00000000_0x0000D1A2_phys_0_eng_%u_engtype_%s", pid, engine, kEngineTypes[engine % std::size(kEngineTypes)]);
+
+        names.emplace_back(name);
+    }
+
+    return names;
+}
+
+template <typename Fn>
+static auto measure(const char* label, Fn&& fn) -> void
+{
+    uint64_t checksum = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i)
+        checksum += fn();
+    const auto end = std::chrono::steady_clock::now();
+
+    const double total_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-24s %8.1f ns/name %8.3f ms/tick (checksum %llu)\n",
+        label,
+        total_ns / (kIterations * kNameCount),
+        total_ns / kIterations / 1'000'000.0,
+        static_cast<unsigned long long>(checksum));
+}
+
+int main()
+{
+    const std::vector<std::string> names = generateNames();
+
+    // Make sure both parsers agree before timing anything.
+    for (const auto& name : names) {
+        LegacyInstanceKey legacy = {};
+        legacyParse(name, legacy);
+
+        GpuInstanceName parsed = {};
+        if (!ParseGpuInstanceName(name, parsed) ||
+            parsed.pid != legacy.pid ||
+            parsed.luid_low != legacy.luid_low ||
+            parsed.luid_high != legacy.luid_high ||
+            parsed.gpu_index != legacy.gpu_index ||
+            parsed.engine_index != legacy.engine_index ||
+            parsed.engine_type != legacy.engine_type) {
+            printf("Parser mismatch for \"%s\"\n", name.c_str());
+            return 1;
+        }
+    }
+
+    printf("%zu names, %d ticks\n\n", names.size(), kIterations);
+
+    measure("stringstream (legacy)", [&] {
+        uint64_t sum = 0;
+        LegacyInstanceKey key = {};
+        for (const auto& name : names) {
+            legacyParse(name, key);
+            sum += key.pid + key.engine_index;
+        }
+        return sum;
+    });
+
+    measure("string_view tokenizer", [&] {
+        uint64_t sum = 0;
+        GpuInstanceName parsed = {};
+        for (const auto& name : names) {
+            ParseGpuInstanceName(name, parsed);
+            sum += parsed.pid + parsed.engine_index;
+        }
+        return sum;
+    });
+
+    GpuInstanceCache cache;
+    measure("instance cache", [&] {
+        uint64_t sum = 0;
+        for (const auto& name : names) {
+            const GpuInstanceKey* key = cache.Lookup(name);
+            sum += key->pid + key->engine_index;
+        }
+        cache.EndTick();
+        return sum;
+    });
+
+    return 0;
+}
\ No newline at end of file
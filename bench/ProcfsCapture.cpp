@@ -0,0 +1,412 @@
+// Records the procfs and sysfs files read by ProcfsProcessSampler and replays them.
+//
+//   procfs_capture capture <directory> [ticks] [interval ms]
+//   procfs_capture replay <directory> [loops]
+//
+// A capture is a directory with a manifest and one directory per tick:
+//
+//   manifest                       clock_ticks, page_size, processors, memory and one "tick <dir> <ns>" per tick
+//   000000/proc/{stat,meminfo,diskstats}
+//   000000/proc/pressure/{cpu,memory,io}
+//   000000/proc/<pid>/{stat,statm,comm,cgroup,status,io}
+//   000000/proc/<pid>/fd/<fd>      symlinks, only the ones pointing at /dev/dri
+//   000000/proc/<pid>/fdinfo/<fd>  DRM usage stats of those descriptors
+//   000000/sys/class/drm/cardN/device -> ../../../devices/<pci slot>
+//   000000/sys/devices/<pci slot>/{mem_info_vram_total,mem_info_gtt_total,driver}
+//   000000/sys/devices/system/cpu/cpuN/cpufreq/scaling_cur_freq
+//   000000/sys/block/<disk>/device  empty file, marks the disks that aren't virtual
+//   000000/sys/class/hwmon/hwmonN/{name,temp*,fan*,freq*,device/pp_dpm_sclk}
+//   000000/sys/class/thermal/thermal_zoneN/{type,temp}
+//   000000/sys/devices/system/cpu/cpu0/{thermal_throttle/package_throttle_count,cpufreq/cpuinfo_max_freq}
+//
+// Replay prints a digest of the table after every tick, two sampler versions
+// that compute the same rows print the same digests for the same capture.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <core/ProcessTable.hpp>
+#include <core/sampler/ReplayProcessSampler.hpp>
+
+static const char* kProcessFiles[] = { "stat", "statm", "comm", "cgroup", "status", "io" };
+static const char* kSystemFiles[] = { "stat", "meminfo", "diskstats", "pressure/cpu", "pressure/memory", "pressure/io" };
+static const char* kAdapterFiles[] = { "mem_info_vram_total", "mem_info_gtt_total" };
+
+static auto monotonicNs() -> uint64_t
+{
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static auto makeDirectories(const std::string& path) -> bool
+{
+    for (size_t separator = path.find('/', 1); ; separator = path.find('/', separator + 1)) {
+        const std::string parent = path.substr(0, separator);
+        if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+        if (separator == std::string::npos)
+            return true;
+    }
+}
+
+// procfs reports a size of zero for most files, so they are read until EOF instead of copied by size.
+static auto copyFile(const std::string& source, const std::string& destination) -> bool
+{
+    int input = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (input < 0)
+        return false;
+
+    char buffer[16384] = {};
+    std::string contents = {};
+    ssize_t length = 0;
+    while ((length = read(input, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, static_cast<size_t>(length));
+    close(input);
+
+    if (length < 0)
+        return false;
+
+    int output = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (output < 0)
+        return false;
+
+    const bool written = write(output, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+    close(output);
+    return written;
+}
+
+static auto readLink(const std::string& path) -> std::string
+{
+    char target[PATH_MAX] = {};
+    ssize_t length = readlink(path.c_str(), target, sizeof(target) - 1);
+    return length > 0 ? std::string(target, static_cast<size_t>(length)) : std::string{};
+}
+
+static auto numericEntries(const std::string& path) -> std::vector<uint32_t>
+{
+    std::vector<uint32_t> entries = {};
+
+    DIR* directory = opendir(path.c_str());
+    if (directory == nullptr)
+        return entries;
+
+    while (dirent* entry = readdir(directory)) {
+        uint32_t value = 0;
+        const char* name_end = entry->d_name + strlen(entry->d_name);
+        auto [ptr, ec] = std::from_chars(entry->d_name, name_end, value);
+        if (ec == std::errc() && ptr == name_end)
+            entries.push_back(value);
+    }
+
+    closedir(directory);
+    return entries;
+}
+
+static auto captureProcess(uint32_t pid, const std::string& root) -> void
+{
+    const std::string source = "/proc/" + std::to_string(pid);
+    const std::string destination = root + source;
+
+    if (!makeDirectories(destination))
+        return;
+
+    for (const char* file : kProcessFiles)
+        copyFile(source + "/" + file, destination + "/" + file);
+
+    // Only DRM descriptors are captured, the sampler ignores every other fd.
+    for (uint32_t fd : numericEntries(source + "/fd")) {
+        const std::string link = "/fd/" + std::to_string(fd);
+        const std::string target = readLink(source + link);
+        if (!target.starts_with("/dev/dri/"))
+            continue;
+
+        const std::string fdinfo = "/fdinfo/" + std::to_string(fd);
+        if (!makeDirectories(destination + "/fd") || !makeDirectories(destination + "/fdinfo"))
+            continue;
+
+        symlink(target.c_str(), (destination + link).c_str());
+        copyFile(source + fdinfo, destination + fdinfo);
+    }
+}
+
+static auto captureSystem(const std::string& root) -> void
+{
+    if (makeDirectories(root + "/proc/pressure")) {
+        for (const char* file : kSystemFiles)
+            copyFile(std::string("/proc/") + file, root + "/proc/" + file);
+    }
+
+    const std::string cpus = "/sys/devices/system/cpu";
+    DIR* directory = opendir(cpus.c_str());
+    if (directory == nullptr)
+        return;
+
+    while (dirent* entry = readdir(directory)) {
+        const std::string_view name = entry->d_name;
+        if (!name.starts_with("cpu") || name.size() == 3 || name.find_first_not_of("0123456789", 3) != std::string_view::npos)
+            continue;
+
+        const std::string cpufreq = cpus + "/" + std::string(name) + "/cpufreq";
+        if (access((cpufreq + "/scaling_cur_freq").c_str(), R_OK) != 0 || !makeDirectories(root + cpufreq))
+            continue;
+
+        copyFile(cpufreq + "/scaling_cur_freq", root + cpufreq + "/scaling_cur_freq");
+    }
+
+    closedir(directory);
+
+    // The sampler only checks that the device link exists, an empty file stands in for it.
+    const std::string blocks = "/sys/block";
+    directory = opendir(blocks.c_str());
+    if (directory == nullptr)
+        return;
+
+    while (dirent* entry = readdir(directory)) {
+        const std::string block = blocks + "/" + entry->d_name;
+        if (entry->d_name[0] == '.' || access((block + "/device").c_str(), F_OK) != 0 || !makeDirectories(root + block))
+            continue;
+
+        const int marker = open((root + block + "/device").c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (marker >= 0)
+            close(marker);
+    }
+
+    closedir(directory);
+}
+
+static auto captureSensors(const std::string& root) -> void
+{
+    const std::string hwmon = "/sys/class/hwmon";
+    if (DIR* chips = opendir(hwmon.c_str())) {
+        while (dirent* chip = readdir(chips)) {
+            const std::string base = hwmon + "/" + chip->d_name;
+            if (chip->d_name[0] == '.' || !makeDirectories(root + base))
+                continue;
+
+            // Attributes only, the device and subsystem links lead back into the rest of sysfs.
+            if (DIR* attributes = opendir(base.c_str())) {
+                while (dirent* attribute = readdir(attributes)) {
+                    const std::string_view name = attribute->d_name;
+                    if (name == "name" || name.starts_with("temp") || name.starts_with("fan") || name.starts_with("freq"))
+                        copyFile(base + "/" + std::string(name), root + base + "/" + std::string(name));
+                }
+                closedir(attributes);
+            }
+
+            if (access((base + "/device/pp_dpm_sclk").c_str(), R_OK) == 0 && makeDirectories(root + base + "/device"))
+                copyFile(base + "/device/pp_dpm_sclk", root + base + "/device/pp_dpm_sclk");
+        }
+        closedir(chips);
+    }
+
+    const std::string thermal = "/sys/class/thermal";
+    if (DIR* zones = opendir(thermal.c_str())) {
+        while (dirent* zone = readdir(zones)) {
+            const std::string base = thermal + "/" + zone->d_name;
+            if (!std::string_view(zone->d_name).starts_with("thermal_zone") || !makeDirectories(root + base))
+                continue;
+
+            copyFile(base + "/type", root + base + "/type");
+            copyFile(base + "/temp", root + base + "/temp");
+        }
+        closedir(zones);
+    }
+
+    const std::string cpu = "/sys/devices/system/cpu/cpu0";
+    for (const char* file : { "/thermal_throttle/package_throttle_count", "/cpufreq/cpuinfo_max_freq" }) {
+        const std::string path = cpu + file;
+        if (access(path.c_str(), R_OK) == 0 && makeDirectories(root + path.substr(0, path.rfind('/'))))
+            copyFile(path, root + path);
+    }
+}
+
+static auto captureAdapters(const std::string& root) -> void
+{
+    DIR* drm = opendir("/sys/class/drm");
+    if (drm == nullptr)
+        return;
+
+    while (dirent* entry = readdir(drm)) {
+        const std::string_view name = entry->d_name;
+        if (!name.starts_with("card") || name.find('-') != std::string_view::npos)
+            continue;
+
+        const std::string card = "/sys/class/drm/" + std::string(name);
+        const std::string device = readLink(card + "/device");
+        if (device.empty())
+            continue;
+
+        const std::string bus_id = device.substr(device.rfind('/') + 1);
+        const std::string device_root = root + "/sys/devices/" + bus_id;
+        if (!makeDirectories(device_root) || !makeDirectories(root + card))
+            continue;
+
+        for (const char* file : kAdapterFiles)
+            copyFile(card + "/device/" + file, device_root + "/" + file);
+
+        const std::string driver = readLink(card + "/device/driver");
+        if (!driver.empty())
+            symlink(driver.c_str(), (device_root + "/driver").c_str());
+
+        symlink(("../../../devices/" + bus_id).c_str(), (root + card + "/device").c_str());
+    }
+
+    closedir(drm);
+}
+
+static auto capture(const std::string& directory, uint32_t tick_count, std::chrono::milliseconds interval) -> int
+{
+    if (!makeDirectories(directory)) {
+        printf("Failed to create %s\n", directory.c_str());
+        return 1;
+    }
+
+    FILE* manifest = fopen((directory + "/manifest").c_str(), "w");
+    if (manifest == nullptr) {
+        printf("Failed to create the manifest in %s\n", directory.c_str());
+        return 1;
+    }
+
+    const long page_size = sysconf(_SC_PAGESIZE);
+    fprintf(manifest, "clock_ticks %ld\n", sysconf(_SC_CLK_TCK));
+    fprintf(manifest, "page_size %ld\n", page_size);
+    fprintf(manifest, "processors %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(manifest, "memory %zu\n", static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(page_size));
+
+    const uint64_t start = monotonicNs();
+    auto next_tick = std::chrono::steady_clock::now();
+
+    for (uint32_t tick = 0; tick < tick_count; ++tick) {
+        char name[16] = {};
+        snprintf(name, sizeof(name), "%06u", tick);
+
+        const std::string root = directory + "/" + name;
+        const uint64_t timestamp = monotonicNs() - start;
+
+        const std::vector<uint32_t> pids = numericEntries("/proc");
+        for (uint32_t pid : pids)
+            captureProcess(pid, root);
+        captureSystem(root);
+        captureSensors(root);
+        captureAdapters(root);
+
+        fprintf(manifest, "tick %s %llu\n", name, static_cast<unsigned long long>(timestamp));
+        printf("tick %s: %zu processes\n", name, pids.size());
+
+        next_tick += interval;
+        std::this_thread::sleep_until(next_tick);
+    }
+
+    fclose(manifest);
+    return 0;
+}
+
+static auto digest(const ProcessTable& table) -> uint64_t
+{
+    // FNV-1a over the rows in pid order, the slot order depends on readdir().
+    std::vector<const ProcessInfo*> rows = {};
+    for (const ProcessInfo& row : table.Rows())
+        rows.push_back(&row);
+    std::ranges::sort(rows, {}, &ProcessInfo::pid);
+
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * 1099511628211ull;
+    };
+
+    for (const ProcessInfo* row : rows) {
+        const std::string_view name = table.String(row->name_id);
+        mix(&row->pid, sizeof(row->pid));
+        mix(&row->parent_pid, sizeof(row->parent_pid));
+        mix(name.data(), name.size());
+        mix(&row->memory_usage, sizeof(row->memory_usage));
+        mix(&row->cpu.total_cpu_usage, sizeof(row->cpu.total_cpu_usage));
+        mix(&row->io, sizeof(row->io));
+
+        for (const auto& [gpu_index, gpu] : row->gpus) {
+            mix(&gpu.memory.dedicated_vram_usage, sizeof(gpu.memory.dedicated_vram_usage));
+            for (const auto& [engine_index, engine] : gpu.engines)
+                mix(&engine.utilization_percentage, sizeof(engine.utilization_percentage));
+        }
+    }
+
+    return hash;
+}
+
+static auto replay(const std::string& directory, uint32_t loops) -> int
+{
+    ReplayProcessSampler sampler(directory);
+    if (!sampler.Initialize())
+        return 1;
+
+    ProcessTable table;
+    SystemInfo system = {};
+    double total_ms = 0.0;
+    const size_t tick_count = sampler.Ticks().size() * loops;
+
+    for (size_t i = 0; i < tick_count; ++i) {
+        const size_t position = sampler.Position();
+
+        const auto start = std::chrono::steady_clock::now();
+        table.BeginTick();
+        sampler.Sample(table, MetricGroup_All);
+        table.EndTick();
+        sampler.SampleSystem(system, MetricGroup_All);
+        const auto end = std::chrono::steady_clock::now();
+
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        total_ms += elapsed_ms;
+
+        printf("tick %06zu: %5zu rows +%zu -%zu ~%zu digest %016llx max core %5.1f %% disk %5.1f %% %8.3f ms\n",
+            position,
+            table.Size(),
+            table.Added().size(),
+            table.Removed().size(),
+            table.Changed().size(),
+            static_cast<unsigned long long>(digest(table)),
+            system.max_core_usage,
+            system.disks.empty() ? 0.0f : system.disks[system.busiest_disk].utilization_percentage,
+            elapsed_ms);
+    }
+
+    printf("\n%zu ticks, %.3f ms/tick\n", tick_count, tick_count > 0 ? total_ms / static_cast<double>(tick_count) : 0.0);
+
+    sampler.Destroy();
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    auto argument = [&](int index, uint32_t fallback) -> uint32_t {
+        uint32_t value = fallback;
+        if (index < argc)
+            std::from_chars(argv[index], argv[index] + strlen(argv[index]), value);
+        return value;
+    };
+
+    if (argc >= 3 && strcmp(argv[1], "capture") == 0)
+        return capture(argv[2], argument(3, 20), std::chrono::milliseconds(argument(4, 500)));
+    if (argc >= 3 && strcmp(argv[1], "replay") == 0)
+        return replay(argv[2], argument(3, 1));
+
+    printf("usage: %s capture <directory> [ticks] [interval ms]\n", argv[0]);
+    printf("       %s replay <directory> [loops]\n", argv[0]);
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,352 @@
+// Measures the cost of a TaskMonitor tick against the size of the system, using
+// a synthetic /proc and /sys tree so the numbers don't depend on the machine.
+//
+//   sampler_bench [ticks]
+//
+// Every scenario runs in its own child process so the peak RSS belongs to it alone.
+// Reported per scenario: tick latency percentiles, heap allocations per tick and peak RSS.
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <core/TaskMonitor.hpp>
+#include <core/sampler/ProcfsProcessSampler.hpp>
+
+constexpr uint64_t kTickNs = 500'000'000;
+constexpr int kWarmupTicks = 3;
+constexpr uint32_t kFirstPid = 1000;
+
+// Replaced to count heap allocations, kept out of line so GCC doesn't pair the inlined free() with operator new.
+static std::atomic<uint64_t> g_allocations = 0;
+
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = malloc(size > 0 ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::size_t) noexcept
+{
+    free(pointer);
+}
+
+enum Scenario_Type : uint8_t {
+    Scenario_Processes = 0,     // full tick, TaskMonitor::samplingLoop()
+    Scenario_Threads = 1,       // focused tick, TaskMonitor::focusLoop()
+};
+
+struct Scenario {
+    Scenario_Type type;
+    uint32_t processes;
+    uint32_t gpu_clients;       // processes holding a DRM client
+    uint32_t threads;           // threads of the first process
+};
+
+static const Scenario kScenarios[] = {
+    { Scenario_Processes, 100, 0, 1 },
+    { Scenario_Processes, 1'000, 0, 1 },
+    { Scenario_Processes, 5'000, 0, 1 },
+    { Scenario_Processes, 20'000, 0, 1 },
+    { Scenario_Processes, 1'000, 10, 1 },
+    { Scenario_Processes, 1'000, 100, 1 },
+    { Scenario_Processes, 1'000, 1'000, 1 },
+    { Scenario_Threads, 1, 0, 10 },
+    { Scenario_Threads, 1, 0, 100 },
+    { Scenario_Threads, 1, 0, 1'000 },
+    { Scenario_Threads, 1, 0, 5'000 },
+};
+
+static auto writeFile(const std::string& path, const char* contents) -> void
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+
+    // Rewritten in place, descriptors the sampler keeps open see the new contents like on procfs.
+    [[maybe_unused]] ssize_t written = write(fd, contents, strlen(contents));
+    close(fd);
+}
+
+// Synthetic system, counters advance every tick for a rotating tenth of the processes.
+class SyntheticSystem {
+public:
+    explicit SyntheticSystem(const Scenario& scenario, std::string root)
+    {
+        scenario_ = scenario;
+        root_ = std::move(root);
+        tick_ = 0;
+    }
+
+    auto Create() -> void
+    {
+        mkdir((root_ + "/proc").c_str(), 0755);
+        mkdir((root_ + "/sys").c_str(), 0755);
+        mkdir((root_ + "/sys/class").c_str(), 0755);
+        mkdir((root_ + "/sys/class/drm").c_str(), 0755);
+        mkdir((root_ + "/sys/class/drm/card0").c_str(), 0755);
+        mkdir((root_ + "/sys/devices").c_str(), 0755);
+        mkdir((root_ + "/sys/devices/0000:03:00.0").c_str(), 0755);
+        writeFile(root_ + "/sys/devices/0000:03:00.0/mem_info_vram_total", "17163091968\n");
+        writeFile(root_ + "/sys/devices/0000:03:00.0/mem_info_gtt_total", "33554432000\n");
+        symlink("../../../devices/0000:03:00.0", (root_ + "/sys/class/drm/card0/device").c_str());
+        symlink("../../../bus/pci/drivers/amdgpu", (root_ + "/sys/devices/0000:03:00.0/driver").c_str());
+
+        char buffer[512] = {};
+
+        for (uint32_t i = 0; i < scenario_.processes; ++i) {
+            const uint32_t pid = kFirstPid + i;
+            const std::string process = root_ + "/proc/" + std::to_string(pid);
+            mkdir(process.c_str(), 0755);
+
+            snprintf(buffer, sizeof(buffer), "0::/user.slice/app-%u.scope\n", pid / 8);
+            writeFile(process + "/cgroup", buffer);
+            snprintf(buffer, sizeof(buffer), "%u %u 2000 100 0 3000 0\n", 10'000 + pid, 1'000 + pid % 4'096);
+            writeFile(process + "/statm", buffer);
+            writeStat(process + "/stat", pid, 0);
+
+            if (i < scenario_.gpu_clients) {
+                mkdir((process + "/fd").c_str(), 0755);
+                mkdir((process + "/fdinfo").c_str(), 0755);
+                symlink("/dev/dri/renderD128", (process + "/fd/12").c_str());
+                writeFdinfo(process + "/fdinfo/12", pid, 0);
+            }
+        }
+
+        const std::string task = root_ + "/proc/" + std::to_string(kFirstPid) + "/task";
+        mkdir(task.c_str(), 0755);
+        for (uint32_t i = 0; i < scenario_.threads; ++i) {
+            const std::string thread = task + "/" + std::to_string(kFirstPid + i);
+            mkdir(thread.c_str(), 0755);
+            writeStat(thread + "/stat", kFirstPid + i, 0);
+            writeFile(thread + "/schedstat", "0 0 0\n");
+            writeFile(thread + "/status", "voluntary_ctxt_switches:\t0\nnonvoluntary_ctxt_switches:\t0\n");
+        }
+    }
+
+    auto Advance() -> void
+    {
+        ++tick_;
+
+        char buffer[64] = {};
+
+        if (scenario_.type == Scenario_Threads) {
+            for (uint32_t i = 0; i < scenario_.threads; ++i) {
+                const std::string thread = root_ + "/proc/" + std::to_string(kFirstPid) + "/task/" + std::to_string(kFirstPid + i);
+                snprintf(buffer, sizeof(buffer), "%llu %llu %llu\n",
+                    static_cast<unsigned long long>(tick_ * (i % 10) * 1'000'000),
+                    static_cast<unsigned long long>(tick_ * (i % 3) * 100'000),
+                    static_cast<unsigned long long>(tick_ * 4));
+                writeFile(thread + "/schedstat", buffer);
+            }
+            return;
+        }
+
+        for (uint32_t i = static_cast<uint32_t>(tick_ % 10); i < scenario_.processes; i += 10) {
+            const uint32_t pid = kFirstPid + i;
+            const std::string process = root_ + "/proc/" + std::to_string(pid);
+            writeStat(process + "/stat", pid, tick_);
+            if (i < scenario_.gpu_clients)
+                writeFdinfo(process + "/fdinfo/12", pid, tick_);
+        }
+    }
+private:
+    auto writeStat(const std::string& path, uint32_t pid, uint64_t tick) -> void
+    {
+        char buffer[512] = {};
+        snprintf(buffer, sizeof(buffer),
+            "%u (process-%u) S 1 %u %u 0 -1 4194560 100 0 0 0 %llu %llu 0 0 20 0 1 0 %u 10000000 1000 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0\n",
+            pid, pid, pid, pid,
+            static_cast<unsigned long long>(tick * 3),
+            static_cast<unsigned long long>(tick),
+            pid);
+        writeFile(path, buffer);
+    }
+
+    auto writeFdinfo(const std::string& path, uint32_t pid, uint64_t tick) -> void
+    {
+        char buffer[1024] = {};
+        snprintf(buffer, sizeof(buffer),
+            "pos:\t0\nflags:\t02100002\nmnt_id:\t25\ndrm-driver:\tamdgpu\ndrm-pdev:\t0000:03:00.0\ndrm-client-id:\t%u\n"
+            "drm-memory-vram:\t%u KiB\ndrm-memory-gtt:\t2048 KiB\ndrm-memory-cpu:\t0 KiB\n"
+            "drm-engine-gfx:\t%llu ns\ndrm-engine-compute:\t0 ns\ndrm-engine-enc:\t%llu ns\ndrm-engine-dec:\t0 ns\n",
+            pid, 65'536 + pid,
+            static_cast<unsigned long long>(tick * 250'000'000),
+            static_cast<unsigned long long>(tick * 50'000'000));
+        writeFile(path, buffer);
+    }
+
+    Scenario scenario_;
+    std::string root_;
+    uint64_t tick_;
+};
+
+static auto removeTree(const char* root) -> void
+{
+    nftw(root, [](const char* path, const struct stat*, int, FTW*) { return remove(path); }, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static auto percentile(std::vector<double>& samples, double fraction) -> double
+{
+    if (samples.empty())
+        return 0.0;
+
+    const size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
+
+static auto runScenario(const Scenario& scenario, int tick_count) -> int
+{
+    char root[] = "/tmp/sampler_bench.XXXXXX";
+    if (mkdtemp(root) == nullptr)
+        return 1;
+
+    SyntheticSystem synthetic(scenario, root);
+    synthetic.Create();
+
+    uint64_t clock = 0;
+    ProcfsSource source = {};
+    source.root = root;
+    source.clock = [&clock] { return clock; };
+    source.clock_ticks = 100;
+    source.page_size = 4096;
+    source.processor_count = 16;
+    source.system_memory = 32ull * 1024 * 1024 * 1024;
+
+    ProcfsProcessSampler sampler(std::move(source));
+    if (!sampler.Initialize()) {
+        removeTree(root);
+        return 1;
+    }
+
+    // Same steps as TaskMonitor::samplingLoop() and TaskMonitor::publish(), without the threads.
+    ProcessTable table;
+    ProcessTree tree;
+    SystemInfo system = {};
+    std::shared_ptr<ProcessSnapshot> published = nullptr;
+    std::shared_ptr<ProcessSnapshot> recycled = nullptr;
+    std::vector<ThreadInfo> threads = {};
+    SchedulerInfo scheduler = {};
+    size_t rows = 0;
+
+    auto tick = [&] {
+        if (scenario.type == Scenario_Threads) {
+            ProcessInfo info = {};
+            sampler.SampleFocus(kFirstPid, info, MetricGroup_Cpu | MetricGroup_Memory);
+            sampler.SampleThreads(kFirstPid, threads, FocusThread_Count, scheduler);
+            rows = threads.size();
+            return;
+        }
+
+        table.BeginTick();
+        sampler.Sample(table, MetricGroup_All);
+        table.EndTick();
+        tree.Apply(table);
+        sampler.SampleSystem(system, MetricGroup_All);
+
+        std::shared_ptr<ProcessSnapshot> snapshot = recycled != nullptr ? std::move(recycled) : std::make_shared<ProcessSnapshot>();
+        snapshot->table = table;
+        snapshot->columns.Build(snapshot->table);
+        snapshot->tree = tree;
+        snapshot->system = system;
+        recycled = std::exchange(published, std::move(snapshot));
+        rows = table.Size();
+    };
+
+    std::vector<double> latencies = {};
+    latencies.reserve(static_cast<size_t>(tick_count));
+    uint64_t allocations = 0;
+
+    for (int i = 0; i < kWarmupTicks + tick_count; ++i) {
+        synthetic.Advance();
+        clock += scenario.type == Scenario_Threads ? kTickNs / 20 : kTickNs;
+
+        const uint64_t allocations_before = g_allocations.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        tick();
+        const auto end = std::chrono::steady_clock::now();
+
+        if (i < kWarmupTicks)
+            continue;
+
+        latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocations_before;
+    }
+
+    sampler.Destroy();
+
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    char label[64] = {};
+    if (scenario.type == Scenario_Threads)
+        snprintf(label, sizeof(label), "threads=%u", scenario.threads);
+    else if (scenario.gpu_clients > 0)
+        snprintf(label, sizeof(label), "processes=%u gpu=%u", scenario.processes, scenario.gpu_clients);
+    else
+        snprintf(label, sizeof(label), "processes=%u", scenario.processes);
+
+    printf("%-28s %6zu %9.3f %9.3f %9.3f %9.3f %12.1f %10.1f\n",
+        label,
+        rows,
+        percentile(latencies, 0.50),
+        percentile(latencies, 0.90),
+        percentile(latencies, 0.99),
+        *std::ranges::max_element(latencies),
+        static_cast<double>(allocations) / tick_count,
+        usage.ru_maxrss / 1024.0);
+
+    fflush(stdout);
+    removeTree(root);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int tick_count = 50;
+    if (argc > 1)
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), tick_count);
+    tick_count = std::max(tick_count, 1);
+
+    printf("%d ticks per scenario after %d warm-up ticks\n\n", tick_count, kWarmupTicks);
+    printf("%-28s %6s %9s %9s %9s %9s %12s %10s\n", "scenario", "rows", "p50 ms", "p90 ms", "p99 ms", "max ms", "allocs/tick", "peak MiB");
+    fflush(stdout);
+
+    int result = 0;
+    for (const Scenario& scenario : kScenarios) {
+        const pid_t child = fork();
+        if (child == 0)
+            _exit(runScenario(scenario, tick_count));
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            result = 1;
+    }
+
+    return result;
+}
\ No newline at end of file
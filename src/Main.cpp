@@ -31,6 +31,8 @@
 #include <renderer/VulkanRenderer.h>
 #include <helper/VulkanHelper.h>
 
+#include <core/TaskMonitor.hpp>
+
 #include <overlay/controller/ControllerOverlay.h>
 #include <overlay/dashboard/DashboardOverlay.h>
 
@@ -42,6 +44,7 @@ extern "C" __declspec(dllexport) unsigned long AmdPowerXpressRequestHighPerforma
 #endif
 
 VulkanRenderer* g_vulkanRenderer = new VulkanRenderer();
+TaskMonitor* g_taskMonitor = new TaskMonitor();
 
 std::unique_ptr<ControllerOverlay> g_processInformation;
 std::unique_ptr<DashboardOverlay>  g_ProcessList;
@@ -109,6 +112,8 @@ int main(
         return EXIT_FAILURE;
     }
 
+    g_taskMonitor->Initialize();
+
     g_processInformation = std::make_unique<ControllerOverlay>();
     g_ProcessList = std::make_unique<DashboardOverlay>();
 
@@ -188,6 +193,8 @@ int main(
     g_processInformation->Destroy();
     g_ProcessList->Destroy();
 
+    g_taskMonitor->Destroy();
+
     g_vulkanRenderer->DestroySurface(g_processInformation->Surface());
     g_vulkanRenderer->DestroySurface(g_ProcessList->Surface());
     g_vulkanRenderer->Destroy();
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+struct AdapterInfo {
+    uint32_t adapter_index;     // DXGI enumeration order on Windows, DRM card number on Linux
+    struct {
+        uint32_t low;
+        uint64_t high;
+    } luid;                     // zero on Linux
+    std::string bus_id;         // PCI slot (ie. 0000:03:00.0), empty on Windows
+    std::string name;
+    size_t dedicated_memory;    // bytes
+    size_t shared_memory;       // bytes
+};
+
+// Capabilities of the GPUs in the system. Querying them goes through the
+// driver, so they are enumerated once and only again when an adapter is added or removed.
+class AdapterRegistry {
+public:
+    virtual ~AdapterRegistry() = default;
+
+    // Re-enumerates the adapters if they changed since the last call, returns true if they did.
+    virtual auto Refresh() -> bool = 0;
+
+    [[nodiscard]] auto Adapters() const -> const std::vector<AdapterInfo>& { return adapters_; }
+
+    [[nodiscard]] auto Find(uint32_t adapter_index) const -> const AdapterInfo* {
+        auto it = std::ranges::find(adapters_, adapter_index, &AdapterInfo::adapter_index);
+        return it != adapters_.end() ? &*it : nullptr;
+    }
+
+    [[nodiscard]] auto FindByLuid(uint32_t low, uint64_t high) const -> const AdapterInfo* {
+        auto it = std::ranges::find_if(adapters_, [&](const AdapterInfo& adapter) { return adapter.luid.low == low && adapter.luid.high == high; });
+        return it != adapters_.end() ? &*it : nullptr;
+    }
+
+    [[nodiscard]] auto FindByBusId(std::string_view bus_id) const -> const AdapterInfo* {
+        auto it = std::ranges::find(adapters_, bus_id, &AdapterInfo::bus_id);
+        return it != adapters_.end() ? &*it : nullptr;
+    }
+
+    static auto Create() -> std::unique_ptr<AdapterRegistry>;
+protected:
+    std::vector<AdapterInfo> adapters_;
+};
\ No newline at end of file
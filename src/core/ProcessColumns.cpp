@@ -0,0 +1,57 @@
+#include "ProcessColumns.hpp"
+
+auto ProcessColumns::Build(const ProcessTable& table) -> void
+{
+    Clear();
+
+    const size_t count = table.Size();
+    pid.reserve(count);
+    cpu_usage.reserve(count);
+    gpu_usage.reserve(count);
+    video_usage.reserve(count);
+    dedicated_vram_usage.reserve(count);
+    shared_vram_usage.reserve(count);
+    memory_usage.reserve(count);
+    disk_read_usage.reserve(count);
+    disk_write_usage.reserve(count);
+    name.reserve(count);
+    names.reserve(count);
+
+    for (const auto& process : table.Rows()) {
+        const GpuInfo& gpu = getCurrentlyUsedGpu(process);
+
+        pid.push_back(process.pid);
+        cpu_usage.push_back(process.cpu.total_cpu_usage);
+        gpu_usage.push_back(gpuPercentage(gpu));
+        video_usage.push_back(gpuVideoPercentage(gpu));
+        dedicated_vram_usage.push_back(gpu.memory.dedicated_vram_usage);
+        shared_vram_usage.push_back(gpu.memory.shared_vram_usage);
+        memory_usage.push_back(process.memory_usage);
+        disk_read_usage.push_back(process.io.read_bytes_per_second);
+        disk_write_usage.push_back(process.io.write_bytes_per_second);
+        names.push_back(table.String(process.name_id));
+    }
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    for (const auto& process : table.Rows()) {
+        auto it = std::lower_bound(names.begin(), names.end(), table.String(process.name_id));
+        name.push_back(static_cast<uint32_t>(it - names.begin()));
+    }
+}
+
+auto ProcessColumns::Clear() -> void
+{
+    pid.clear();
+    cpu_usage.clear();
+    gpu_usage.clear();
+    video_usage.clear();
+    dedicated_vram_usage.clear();
+    shared_vram_usage.clear();
+    memory_usage.clear();
+    disk_read_usage.clear();
+    disk_write_usage.clear();
+    name.clear();
+    names.clear();
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+#include <core/ProcessTable.hpp>
+
+// Struct-of-arrays view of a ProcessTable, row i of every column belongs to
+// the same process. Sorting and top-N queries only touch the columns they
+// compare instead of the full ProcessInfo with its maps.
+struct ProcessColumns {
+    std::vector<uint32_t> pid;
+    std::vector<double> cpu_usage;              // percentage
+    std::vector<float> gpu_usage;               // 3D engine percentage
+    std::vector<float> video_usage;             // encode engine percentage
+    std::vector<size_t> dedicated_vram_usage;   // bytes
+    std::vector<size_t> shared_vram_usage;      // bytes
+    std::vector<size_t> memory_usage;           // bytes
+    std::vector<double> disk_read_usage;        // bytes per second
+    std::vector<double> disk_write_usage;       // bytes per second
+    std::vector<uint32_t> name;                 // index into names
+
+    // Distinct process names in ascending order, so comparing name indices
+    // orders rows by name. Views point into the table the columns were built from.
+    std::vector<std::string_view> names;
+
+    [[nodiscard]] auto Size() const -> size_t { return pid.size(); }
+    [[nodiscard]] auto Name(size_t row) const -> std::string_view { return names[name[row]]; }
+
+    // Rebuilds every column from table, keeping the capacity of the arrays.
+    auto Build(const ProcessTable& table) -> void;
+    auto Clear() -> void;
+};
+
+// Fills order with the row indices of column sorted by its values.
+template <typename T>
+auto SortByColumn(const std::vector<T>& column, bool ascending, std::vector<uint32_t>& order) -> void
+{
+    order.resize(column.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    if (ascending)
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return column[a] < column[b]; });
+    else
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return column[a] > column[b]; });
+}
+
+// Fills order with the row indices of the count largest values of column, largest first.
+template <typename T>
+auto TopByColumn(const std::vector<T>& column, size_t count, std::vector<uint32_t>& order) -> void
+{
+    order.resize(column.size());
+    std::iota(order.begin(), order.end(), 0u);
+
+    count = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](uint32_t a, uint32_t b) { return column[a] > column[b]; });
+    order.resize(count);
+}
\ No newline at end of file
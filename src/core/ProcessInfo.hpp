@@ -0,0 +1,179 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <stdint.h>
+#include <ranges>
+#include <algorithm>
+
+enum GpuEngine_Flags : uint32_t {
+    GpuEngine_None = 0,
+    GpuEngine_3D = 1 << 0,
+    GpuEngine_Copy = 1 << 1,
+    GpuEngine_Compute = 1 << 2,
+    GpuEngine_VideoDecode = 1 << 3,
+    GpuEngine_VideoEncode = 1 << 4,
+    GpuEngine_VideoCodec = 1 << 5,
+    GpuEngine_Other = 1 << 6,
+    GpuEngine_Video = GpuEngine_VideoEncode | GpuEngine_VideoCodec,
+};
+
+struct GpuEngine {
+    uint32_t engine_index;
+    uint32_t engine_type; // GpuEngine_Flags
+    float utilization_percentage;
+};
+
+struct VRAMInfo {
+    size_t dedicated_vram_usage;
+    size_t shared_vram_usage;
+    size_t dedicated_available;
+    size_t shared_available;
+};
+
+struct GpuInfo {
+    struct {
+        uint32_t low;
+        uint64_t high;
+    } luid;
+    uint32_t gpu_index;
+    uint32_t adapter_index; // AdapterInfo::adapter_index
+    std::unordered_map<uint64_t, GpuEngine> engines;
+    VRAMInfo memory;
+};
+
+struct ProcessInfo {
+    uint32_t pid;
+    uint32_t name_id; // interned in the StringPool of the owning ProcessTable
+    uint32_t parent_pid;
+    uint32_t cgroup_id; // interned cgroup v2 path, 0 on Windows
+    std::unordered_map<uint32_t, GpuInfo> gpus;
+    size_t memory_usage;
+    size_t memory_available; // system ram
+    size_t swap_usage;       // bytes swapped out, 0 on Windows and while the system has nothing swapped out
+    struct {
+        double user_cpu_usage;
+        double kernel_cpu_usage;
+        double total_cpu_usage;
+    } cpu;
+    struct {
+        double minor_per_second;
+        double major_per_second; // had to wait for a disk read, always 0 on Windows where minor counts both
+    } faults;
+    struct {
+        double read_bytes_per_second;   // fetched from storage on Linux, every read including network and devices on Windows
+        double write_bytes_per_second;
+        double read_calls_per_second;   // read syscalls on Linux, I/O operations on Windows
+        double write_calls_per_second;
+    } io;
+};
+
+enum ThreadState : uint8_t {
+    ThreadState_Running = 0,    // on a CPU or waiting in the run queue
+    ThreadState_Sleeping = 1,
+    ThreadState_IoWait = 2,     // uninterruptible sleep, mostly disk or driver I/O
+    ThreadState_Count = 3,
+};
+
+struct ThreadInfo {
+    uint32_t tid;
+    std::string name;
+    double cpu_usage; // percent of a single core, a saturated thread is at 100
+    float state_fractions[ThreadState_Count]; // recent share of time in each state, all zero if the platform doesn't report states
+    double wait_percentage;         // share of wall time runnable but waiting for a CPU, 0 if the platform doesn't report it
+    double voluntary_switches;      // per second, the thread blocked or yielded
+    double involuntary_switches;    // per second, the thread was preempted
+};
+
+// Memory accounting that has to walk the mappings of a process, only computed for a few selected processes.
+struct MemoryDetail {
+    uint32_t pid;
+    size_t resident;    // same as ProcessInfo::memory_usage, taken at the same time as the values below
+    size_t pss;         // shared pages divided by the number of processes mapping them, 0 on Windows
+    size_t uss;         // pages no other process maps, the private working set on Windows
+    size_t swap;        // 0 on Windows
+};
+
+// Scheduler statistics summed over every thread of a process, zero where the platform doesn't report them.
+struct SchedulerInfo {
+    double wait_percentage;         // run-queue delay of all threads in % of wall time, exceeds 100 when several threads wait at once
+    double voluntary_switches;      // per second
+    double involuntary_switches;    // per second
+};
+
+// Exit of a process as reported by ProcessSampler::TakeExits().
+struct ProcessExit {
+    uint32_t pid;
+    uint64_t exit_time;     // ns on the std::chrono::steady_clock, when the process exited
+    int32_t exit_code;      // value passed to exit(), 0 if the process was killed
+    int32_t signal;         // signal that killed the process, 0 if it exited on its own
+    bool has_status;        // false if only exit_time is known
+};
+
+// Decoded once when a counter instance is first seen, the lookups below only compare flags.
+inline auto decodeGpuEngineType = [](std::string_view engine_type) -> uint32_t
+{
+    if (engine_type.empty())
+        return GpuEngine_None;
+    if (engine_type == "3D")
+        return GpuEngine_3D;
+    if (engine_type.find("Encode") != std::string_view::npos)
+        return GpuEngine_VideoEncode;
+    if (engine_type.find("Codec") != std::string_view::npos)
+        return GpuEngine_VideoCodec;
+    if (engine_type.find("Decode") != std::string_view::npos)
+        return GpuEngine_VideoDecode;
+    if (engine_type.starts_with("Copy"))
+        return GpuEngine_Copy;
+    if (engine_type.starts_with("Compute"))
+        return GpuEngine_Compute;
+    return GpuEngine_Other;
+};
+
+inline auto getCurrentlyUsedGpu = [](const ProcessInfo& info) -> const GpuInfo&
+{
+    static const GpuInfo empty = {};
+
+    auto gpuIt = std::ranges::find_if(info.gpus, [](auto& gpuEntry) {
+        auto& [gpuId, gpu] = gpuEntry;
+        return std::ranges::find_if(gpu.engines, [](auto& engEntry) {
+            const auto& [idx, eng] = engEntry;
+            return (eng.engine_type & GpuEngine_3D) && eng.utilization_percentage > 0.0f;
+        }) != gpu.engines.end();
+    });
+
+    return gpuIt != info.gpus.end()
+        ?
+        gpuIt->second
+        : empty;
+};
+
+inline auto gpuPercentage = [](const GpuInfo& gpu) -> float
+{
+    if (auto it = std::ranges::find_if(gpu.engines,
+        [](const auto& pair) {
+            const auto& [key, eng] = pair;
+            return (eng.engine_type & GpuEngine_3D) &&
+                eng.utilization_percentage > 0.0f;
+        });
+        it != gpu.engines.end())
+    {
+        return it->second.utilization_percentage;
+    }
+    return 0.0f;
+};
+
+inline auto gpuVideoPercentage = [](const GpuInfo& gpu) -> float
+{
+    if (auto it = std::ranges::find_if(gpu.engines,
+        [](const auto& pair) {
+            const auto& [key, eng] = pair;
+            return (eng.engine_type & GpuEngine_Video) && eng.utilization_percentage > 0.0f;
+        });
+        it != gpu.engines.end())
+    {
+        return it->second.utilization_percentage;
+    }
+    return 0.0f;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include <core/ProcessInfo.hpp>
+#include <core/ProcessTable.hpp>
+#include <core/SystemInfo.hpp>
+
+enum MetricGroup_Flags : uint32_t {
+    MetricGroup_None = 0,
+    MetricGroup_Cpu = 1 << 0,
+    MetricGroup_Memory = 1 << 1,
+    MetricGroup_Gpu = 1 << 2,
+    MetricGroup_Disk = 1 << 3,
+    MetricGroup_Thermal = 1 << 4,
+    MetricGroup_Cores = 1 << 5,     // system wide usage and frequency of every core, apart from Cpu which is per process
+    MetricGroup_All = MetricGroup_Cpu | MetricGroup_Memory | MetricGroup_Gpu | MetricGroup_Disk | MetricGroup_Thermal | MetricGroup_Cores
+};
+
+constexpr uint32_t MetricGroup_Count = 6;
+
+// Platform backend used by TaskMonitor to collect per-process statistics.
+// Each platform provides exactly one implementation through ProcessSampler::Create().
+class ProcessSampler {
+public:
+    virtual ~ProcessSampler() = default;
+
+    // Returns false if the backend is unavailable, the sampler is not used afterwards.
+    virtual auto Initialize() -> bool = 0;
+    virtual auto Destroy() -> void = 0;
+
+    // Upserts every live process into table, the caller wraps this in BeginTick()/EndTick().
+    // Metrics outside of metric_groups (MetricGroup_Flags) are left zeroed.
+    virtual auto Sample(ProcessTable& table, uint32_t metric_groups) -> void = 0;
+
+    // Samples a single process at a higher rate than Sample() is called at, only Cpu and Memory are collected.
+    // Runs on its own thread concurrently with Sample(), implementations keep separate state for it.
+    // Returns false if the process doesn't exist (anymore).
+    virtual auto SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool = 0;
+
+    // Fills threads with the count busiest threads of pid, busiest first, and scheduler with the sums over all of them.
+    // Called on the focus thread after SampleFocus().
+    virtual auto SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool = 0;
+
+    // Fills system with the values since the previous call, cores and CPU pressure while Cpu is in metric_groups,
+    // memory and I/O pressure and swap while Memory is, disks while Disk is and sensors while Thermal is. Called on
+    // the sampling thread right after Sample(), values that can't be read are left zeroed instead of throwing.
+    virtual auto SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void = 0;
+
+    // Computes the expensive memory accounting of a single process. Runs on its own thread at a low rate,
+    // concurrently with the other calls, so implementations don't share state with them.
+    virtual auto SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool = 0;
+
+    // Replaces exits with the processes that exited since the previous call, timestamped when they exited.
+    // Called on the sampling thread after Sample(). Backends without exit notifications leave it empty,
+    // TaskMonitor then logs the exit at the tick that no longer found the process.
+    virtual auto TakeExits(std::vector<ProcessExit>& exits) -> void = 0;
+
+    static auto Create() -> std::unique_ptr<ProcessSampler>;
+};
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "ProcessTable.hpp"
+
+#include <algorithm>
+
+// Pools below this size are never compacted, a few thousand strings are cheaper to keep than to rebuild.
+constexpr size_t kStringCompactMinimum = 4096;
+
+ProcessTable::ProcessTable()
+{
+    slots_.clear();
+    strings_ = StringPool();
+    string_generation_ = 0;
+    free_slots_.clear();
+    index_.clear();
+    added_.clear();
+    removed_.clear();
+    changed_.clear();
+    tick_ = 0;
+    tick_complete_ = true;
+}
+
+auto ProcessTable::Find(uint32_t pid) const -> const ProcessInfo*
+{
+    auto it = index_.find(pid);
+    return it != index_.end() ? &slots_[it->second].info : nullptr;
+}
+
+auto ProcessTable::Find(uint32_t pid) -> ProcessInfo*
+{
+    auto it = index_.find(pid);
+    return it != index_.end() ? &slots_[it->second].info : nullptr;
+}
+
+auto ProcessTable::BeginTick() -> void
+{
+    ++tick_;
+
+    if (tick_complete_) {
+        added_.clear();
+        removed_.clear();
+    }
+
+    changed_.clear();
+    tick_complete_ = false;
+}
+
+auto ProcessTable::Upsert(uint32_t pid, uint64_t start_time) -> ProcessInfo&
+{
+    auto [it, inserted] = index_.try_emplace(pid, 0);
+
+    if (!inserted) {
+        Slot& slot = slots_[it->second];
+
+        if (slot.start_time == start_time) {
+            if (slot.last_seen != tick_) {
+                slot.last_seen = tick_;
+                resetMetrics(slot.info);
+            }
+            return slot.info;
+        }
+
+        // The pid was reused by a different process, report it as a removal and an addition.
+        removed_.push_back(pid);
+        free_slots_.push_back(it->second);
+        slots_[it->second].live = false;
+    }
+
+    if (free_slots_.empty()) {
+        it->second = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+    else {
+        it->second = free_slots_.back();
+        free_slots_.pop_back();
+    }
+
+    Slot& slot = slots_[it->second];
+
+    // The GPU maps are rebuilt by the sampler.
+    slot.info.name_id = 0;
+    slot.info.parent_pid = 0;
+    slot.info.cgroup_id = 0;
+    slot.info.gpus.clear();
+    resetMetrics(slot.info);
+    slot.info.pid = pid;
+
+    slot.previous = {};
+    slot.start_time = start_time;
+    slot.last_seen = tick_;
+    slot.live = true;
+
+    added_.push_back(pid);
+
+    return slot.info;
+}
+
+auto ProcessTable::EndTick() -> void
+{
+    // Every row holds at most a name and a cgroup, the pool is rebuilt once it holds twice as many strings.
+    if (strings_.Size() > std::max(kStringCompactMinimum, 4 * index_.size()))
+        compactStrings();
+
+    for (auto it = index_.begin(); it != index_.end(); ) {
+        Slot& slot = slots_[it->second];
+
+        if (slot.last_seen != tick_) {
+            slot.live = false;
+            free_slots_.push_back(it->second);
+            removed_.push_back(it->first);
+            it = index_.erase(it);
+            continue;
+        }
+
+        // Compared against the last completed tick, so a tick that failed halfway doesn't hide changes.
+        const Fingerprint current = fingerprint(slot.info);
+        if (slot.previous != current) {
+            slot.previous = current;
+            changed_.push_back(it->first);
+        }
+
+        ++it;
+    }
+
+    tick_complete_ = true;
+}
+
+auto ProcessTable::Clear() -> void
+{
+    for (auto& [pid, slot_index] : index_) {
+        slots_[slot_index].live = false;
+        free_slots_.push_back(slot_index);
+        removed_.push_back(pid);
+    }
+
+    index_.clear();
+}
+
+auto ProcessTable::compactStrings() -> void
+{
+    // Rows not upserted this tick are retired right after, their strings are dropped with the old pool.
+    // Copies of the table keep reading the old chunks until they are released.
+    StringPool strings;
+    for (Slot& slot : slots_) {
+        if (!slot.live || slot.last_seen != tick_)
+            continue;
+
+        // The fingerprints keep the old ids, so EndTick() reports the renumbered rows as changed.
+        slot.info.name_id = strings.Intern(strings_.Get(slot.info.name_id));
+        slot.info.cgroup_id = strings.Intern(strings_.Get(slot.info.cgroup_id));
+    }
+
+    strings_ = std::move(strings);
+    ++string_generation_;
+}
+
+auto ProcessTable::fingerprint(const ProcessInfo& info) -> Fingerprint
+{
+    Fingerprint result = {
+        .name_id = info.name_id,
+        .parent_pid = info.parent_pid,
+        .cgroup_id = info.cgroup_id,
+        .cpu_usage = info.cpu.total_cpu_usage,
+        .memory_usage = info.memory_usage,
+        .vram_usage = 0,
+        .gpu_usage = 0.0f,
+        .io_usage = info.io.read_bytes_per_second + info.io.write_bytes_per_second,
+    };
+
+    for (const auto& [gpu_index, gpu] : info.gpus) {
+        result.vram_usage += gpu.memory.dedicated_vram_usage + gpu.memory.shared_vram_usage;
+        for (const auto& [engine_index, engine] : gpu.engines)
+            result.gpu_usage += engine.utilization_percentage;
+    }
+
+    return result;
+}
+
+auto ProcessTable::resetMetrics(ProcessInfo& info) -> void
+{
+    info.cpu = {};
+    info.faults = {};
+    info.io = {};
+    info.memory_usage = 0;
+    info.swap_usage = 0;
+
+    // Keep the nodes, only the values are refreshed every tick.
+    for (auto& [gpu_index, gpu] : info.gpus) {
+        gpu.memory.dedicated_vram_usage = 0;
+        gpu.memory.shared_vram_usage = 0;
+        for (auto& [engine_index, engine] : gpu.engines)
+            engine.utilization_percentage = 0.0f;
+    }
+}
\ No newline at end of file
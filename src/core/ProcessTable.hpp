@@ -0,0 +1,98 @@
+#pragma once
+
+#include <ranges>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <core/ProcessInfo.hpp>
+#include <core/StringPool.hpp>
+
+// Stable slot map of processes keyed by pid. Rows are updated in place
+// between ticks so their strings and GPU maps keep their allocations, and
+// the pids added, removed or changed by the last tick are kept for consumers
+// that only want to refresh what changed.
+class ProcessTable {
+public:
+    explicit ProcessTable();
+
+    [[nodiscard]] auto Size() const -> size_t { return index_.size(); }
+    [[nodiscard]] auto Added() const -> const std::vector<uint32_t>& { return added_; }
+    [[nodiscard]] auto Removed() const -> const std::vector<uint32_t>& { return removed_; }
+    [[nodiscard]] auto Changed() const -> const std::vector<uint32_t>& { return changed_; }
+
+    [[nodiscard]] auto Rows() const {
+        return slots_
+            | std::views::filter([](const Slot& slot) { return slot.live; })
+            | std::views::transform([](const Slot& slot) -> const ProcessInfo& { return slot.info; });
+    }
+
+    [[nodiscard]] auto Rows() {
+        return slots_
+            | std::views::filter([](const Slot& slot) { return slot.live; })
+            | std::views::transform([](Slot& slot) -> ProcessInfo& { return slot.info; });
+    }
+
+    [[nodiscard]] auto Find(uint32_t pid) const -> const ProcessInfo*;
+    [[nodiscard]] auto Find(uint32_t pid) -> ProcessInfo*;
+
+    // Process names and cgroup paths are interned, copies of the table share the strings that existed when they were made.
+    // EndTick() rebuilds the pool from the live rows once most of it belongs to exited processes, which renumbers
+    // the ids of the rows and reports them as changed. Ids cached outside of the table are only valid for one StringGeneration().
+    [[nodiscard]] auto String(uint32_t id) const -> std::string_view { return strings_.Get(id); }
+    [[nodiscard]] auto StringGeneration() const -> uint64_t { return string_generation_; }
+    auto Intern(std::string_view value) -> uint32_t { return strings_.Intern(value); }
+
+    // Deltas of a tick that never reached EndTick() are carried over into the next one.
+    auto BeginTick() -> void;
+
+    // Returns the row for pid and marks it as alive for this tick. start_time
+    // identifies the process instance, a different value for a known pid means
+    // the pid was reused and the row is replaced. Metrics of existing rows are
+    // zeroed so values missing from this tick do not linger.
+    auto Upsert(uint32_t pid, uint64_t start_time) -> ProcessInfo&;
+
+    // Retires every row that was not upserted since BeginTick().
+    auto EndTick() -> void;
+
+    auto Clear() -> void;
+private:
+    // Values shown by the overlays, a row is reported as changed when any of them differ.
+    struct Fingerprint {
+        uint32_t name_id;
+        uint32_t parent_pid;
+        uint32_t cgroup_id;
+        double cpu_usage;
+        size_t memory_usage;
+        size_t vram_usage;
+        float gpu_usage;
+        double io_usage;
+
+        auto operator==(const Fingerprint&) const -> bool = default;
+    };
+
+    struct Slot {
+        ProcessInfo info;
+        Fingerprint previous;
+        uint64_t start_time;
+        uint64_t last_seen;
+        bool live;
+    };
+
+    auto compactStrings() -> void;
+
+    static auto fingerprint(const ProcessInfo& info) -> Fingerprint;
+    static auto resetMetrics(ProcessInfo& info) -> void;
+
+    std::vector<Slot> slots_;
+    StringPool strings_;
+    uint64_t string_generation_;    // bumped whenever compactStrings() renumbered the ids
+    std::vector<uint32_t> free_slots_;
+    std::unordered_map<uint32_t, uint32_t> index_;
+    std::vector<uint32_t> added_;
+    std::vector<uint32_t> removed_;
+    std::vector<uint32_t> changed_;
+    uint64_t tick_;
+    bool tick_complete_;
+};
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "ProcessTree.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+static auto eraseValue(std::unordered_map<uint32_t, std::vector<uint32_t>>& lists, uint32_t key, uint32_t value) -> void
+{
+    auto it = lists.find(key);
+    if (it == lists.end())
+        return;
+
+    std::erase(it->second, value);
+    if (it->second.empty())
+        lists.erase(it);
+}
+
+ProcessTree::ProcessTree()
+{
+    nodes_.clear();
+    children_.clear();
+    cgroups_.clear();
+}
+
+auto ProcessTree::Children(uint32_t pid) const -> std::span<const uint32_t>
+{
+    auto it = children_.find(pid);
+    return it != children_.end() ? std::span<const uint32_t>(it->second) : std::span<const uint32_t>();
+}
+
+auto ProcessTree::Parent(uint32_t pid) const -> uint32_t
+{
+    auto it = nodes_.find(pid);
+    return it != nodes_.end() ? it->second.parent_pid : 0;
+}
+
+auto ProcessTree::Apply(const ProcessTable& table) -> void
+{
+    for (uint32_t pid : table.Removed())
+        unlink(pid);
+
+    // Deltas carried over from a failed tick may list a pid that is already gone again.
+    for (uint32_t pid : table.Added()) {
+        if (const ProcessInfo* process = table.Find(pid))
+            link(pid, *process);
+    }
+
+    // Orphans are reparented by the kernel, which shows up as a changed row.
+    for (uint32_t pid : table.Changed()) {
+        const ProcessInfo* process = table.Find(pid);
+        if (process == nullptr)
+            continue;
+
+        auto it = nodes_.find(pid);
+        if (it != nodes_.end() && it->second.parent_pid == process->parent_pid && it->second.cgroup_id == process->cgroup_id)
+            continue;
+
+        unlink(pid);
+        link(pid, *process);
+    }
+}
+
+auto ProcessTree::Rollup(uint32_t pid, const ProcessTable& table) const -> ProcessRollup
+{
+    ProcessRollup rollup = {};
+
+    std::vector<uint32_t> pids = {};
+    std::vector<uint32_t> pending = { pid };
+    std::unordered_set<uint32_t> visited = {};
+
+    // Parent pids aren't validated, Windows keeps reporting the pid of an exited parent after it was
+    // reused. Such links can form a cycle, every pid is only walked once so the loop always ends.
+    while (!pending.empty()) {
+        const uint32_t current = pending.back();
+        pending.pop_back();
+        if (!visited.insert(current).second)
+            continue;
+
+        pids.push_back(current);
+
+        const auto children = Children(current);
+        pending.insert(pending.end(), children.begin(), children.end());
+    }
+
+    // Flatpak, systemd-run and most launchers place each application in its own app-*.scope.
+    if (auto node = nodes_.find(pid); node != nodes_.end() && node->second.cgroup_id != 0) {
+        if (table.String(node->second.cgroup_id).ends_with(".scope")) {
+            if (auto group = cgroups_.find(node->second.cgroup_id); group != cgroups_.end()) {
+                pids.insert(pids.end(), group->second.begin(), group->second.end());
+
+                std::ranges::sort(pids);
+                pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+            }
+        }
+    }
+
+    for (uint32_t current : pids) {
+        const ProcessInfo* process = table.Find(current);
+        if (process == nullptr)
+            continue;
+
+        rollup.process_count++;
+        rollup.cpu_usage += process->cpu.total_cpu_usage;
+        rollup.memory_usage += process->memory_usage;
+
+        for (const auto& [gpu_index, gpu] : process->gpus) {
+            rollup.dedicated_vram_usage += gpu.memory.dedicated_vram_usage;
+            rollup.shared_vram_usage += gpu.memory.shared_vram_usage;
+        }
+    }
+
+    return rollup;
+}
+
+auto ProcessTree::Clear() -> void
+{
+    nodes_.clear();
+    children_.clear();
+    cgroups_.clear();
+}
+
+auto ProcessTree::link(uint32_t pid, const ProcessInfo& process) -> void
+{
+    nodes_[pid] = { process.parent_pid, process.cgroup_id };
+
+    // A process is never its own child, Rollup() would count it twice.
+    if (process.parent_pid != 0 && process.parent_pid != pid)
+        children_[process.parent_pid].push_back(pid);
+    if (process.cgroup_id != 0)
+        cgroups_[process.cgroup_id].push_back(pid);
+}
+
+auto ProcessTree::unlink(uint32_t pid) -> void
+{
+    auto it = nodes_.find(pid);
+    if (it == nodes_.end())
+        return;
+
+    eraseValue(children_, it->second.parent_pid, pid);
+    eraseValue(cgroups_, it->second.cgroup_id, pid);
+    nodes_.erase(it);
+
+    // Windows never reparents, drop the list so a process reusing the pid doesn't inherit it.
+    // On Linux the children are relinked once their new parent shows up as a change.
+    children_.erase(pid);
+}
\ No newline at end of file
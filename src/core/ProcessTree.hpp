@@ -0,0 +1,48 @@
+#pragma once
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <core/ProcessTable.hpp>
+
+// Aggregated usage of a process together with its descendants.
+struct ProcessRollup {
+    uint32_t process_count;
+    double cpu_usage;               // percentage
+    size_t memory_usage;            // bytes
+    size_t dedicated_vram_usage;    // bytes, summed over every adapter
+    size_t shared_vram_usage;       // bytes, summed over every adapter
+};
+
+// Parent/child and cgroup index of the processes in a ProcessTable. It is
+// kept up to date from the deltas of each tick instead of rescanning the table.
+class ProcessTree {
+public:
+    explicit ProcessTree();
+
+    [[nodiscard]] auto Children(uint32_t pid) const -> std::span<const uint32_t>;
+    [[nodiscard]] auto Parent(uint32_t pid) const -> uint32_t;
+
+    // Applies the added, removed and changed pids of table's last tick.
+    auto Apply(const ProcessTable& table) -> void;
+
+    // Sums pid and its descendants. On Linux processes sharing pid's cgroup are
+    // included as well when it is a transient scope, which contains a single application.
+    [[nodiscard]] auto Rollup(uint32_t pid, const ProcessTable& table) const -> ProcessRollup;
+
+    auto Clear() -> void;
+private:
+    struct Node {
+        uint32_t parent_pid;
+        uint32_t cgroup_id;
+    };
+
+    auto link(uint32_t pid, const ProcessInfo& process) -> void;
+    auto unlink(uint32_t pid) -> void;
+
+    std::unordered_map<uint32_t, Node> nodes_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> children_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> cgroups_;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Turns N cumulative counters into deltas and per-second rates. Every update
+// keeps the raw values together with the monotonic time they were read at, so
+// a rate always covers the real interval between two reads of the same source,
+// whether the tick in between was late, early or skipped entirely.
+//
+// instance identifies the owner of the counters, ie. the start time of a
+// process. A different instance, a timestamp that didn't advance or a counter
+// that went backwards restarts the baseline instead of producing a delta that
+// mixes two owners or a wrapped counter.
+template <size_t N>
+class RateCounter {
+public:
+    using Values = std::array<uint64_t, N>;
+
+    RateCounter()
+    {
+        values_ = {};
+        deltas_ = {};
+        instance_ = 0;
+        timestamp_ns_ = 0;
+        elapsed_ns_ = 0;
+        has_baseline_ = false;
+    }
+
+    // Returns true if the previous values were a baseline for these, Delta(), Rate() and Elapsed() are zero otherwise.
+    auto Update(uint64_t instance, uint64_t timestamp_ns, const Values& values) -> bool
+    {
+        bool valid = has_baseline_ && instance == instance_ && timestamp_ns > timestamp_ns_;
+        for (size_t i = 0; valid && i < N; ++i)
+            valid = values[i] >= values_[i];
+
+        for (size_t i = 0; i < N; ++i)
+            deltas_[i] = valid ? values[i] - values_[i] : 0;
+        elapsed_ns_ = valid ? timestamp_ns - timestamp_ns_ : 0;
+
+        values_ = values;
+        instance_ = instance;
+        timestamp_ns_ = timestamp_ns;
+        has_baseline_ = true;
+        return valid;
+    }
+
+    // Forgets the baseline, the next update only stores its values.
+    auto Reset() -> void
+    {
+        deltas_ = {};
+        elapsed_ns_ = 0;
+        has_baseline_ = false;
+    }
+
+    [[nodiscard]] auto HasBaseline() const -> bool { return has_baseline_; }
+    [[nodiscard]] auto Timestamp() const -> uint64_t { return timestamp_ns_; }  // of the last update, 0 if never
+    [[nodiscard]] auto Elapsed() const -> uint64_t { return elapsed_ns_; }
+    [[nodiscard]] auto Value(size_t index) const -> uint64_t { return values_[index]; }
+    [[nodiscard]] auto Delta(size_t index) const -> uint64_t { return deltas_[index]; }
+
+    [[nodiscard]] auto Rate(size_t index) const -> double
+    {
+        return elapsed_ns_ > 0 ? static_cast<double>(deltas_[index]) * 1'000'000'000.0 / static_cast<double>(elapsed_ns_) : 0.0;
+    }
+private:
+    Values values_;
+    Values deltas_;
+    uint64_t instance_;
+    uint64_t timestamp_ns_;
+    uint64_t elapsed_ns_;
+    bool has_baseline_;
+};
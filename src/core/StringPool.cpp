@@ -0,0 +1,68 @@
+#include "StringPool.hpp"
+
+StringPool::StringPool()
+{
+    chunks_.clear();
+    size_ = 0;
+    owns_tail_ = true;
+    index_.clear();
+
+    Intern({});
+}
+
+StringPool::StringPool(const StringPool& other)
+{
+    chunks_ = other.chunks_;
+    size_ = other.size_;
+    owns_tail_ = false;
+    index_.clear();
+}
+
+auto StringPool::operator=(const StringPool& other) -> StringPool&
+{
+    if (this != &other) {
+        chunks_ = other.chunks_;
+        size_ = other.size_;
+        owns_tail_ = false;
+        index_.clear();
+    }
+    return *this;
+}
+
+auto StringPool::Intern(std::string_view value) -> uint32_t
+{
+    if (!owns_tail_)
+        rebuildIndex();
+
+    if (auto it = index_.find(value); it != index_.end())
+        return it->second;
+
+    if (size_ % Chunk_Size == 0)
+        chunks_.push_back(std::make_shared<Chunk>());
+
+    const uint32_t id = size_++;
+    std::string& string = chunks_.back()->strings[id % Chunk_Size];
+    string = value;
+    index_.emplace(string, id);
+
+    return id;
+}
+
+auto StringPool::rebuildIndex() -> void
+{
+    // The partly filled last chunk is shared with the pool this one was copied from,
+    // which appends to it as well. Its strings are copied into a chunk of our own first.
+    if (size_ % Chunk_Size != 0) {
+        auto tail = std::make_shared<Chunk>();
+        for (uint32_t i = 0; i < size_ % Chunk_Size; ++i)
+            tail->strings[i] = chunks_.back()->strings[i];
+        chunks_.back() = std::move(tail);
+    }
+    owns_tail_ = true;
+
+    index_.clear();
+    index_.reserve(size_);
+
+    for (uint32_t id = 0; id < size_; ++id)
+        index_.emplace(Get(id), id);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// Append-only pool of interned strings, equal strings share one id for the
+// lifetime of the pool. Id 0 is always the empty string.
+//
+// Strings are stored in fixed-size chunks that are shared by copies of the
+// pool, so a copy only costs a pointer per chunk. A string is never written
+// again once it got its id and a copy never reads ids past its own size, the
+// original can keep appending to a chunk while copies read it on other threads.
+class StringPool {
+public:
+    explicit StringPool();
+    StringPool(const StringPool& other);
+    auto operator=(const StringPool& other) -> StringPool&;
+    StringPool(StringPool&& other) = default;
+    auto operator=(StringPool&& other) -> StringPool& = default;
+
+    [[nodiscard]] auto Size() const -> size_t { return size_; }
+    [[nodiscard]] auto Get(uint32_t id) const -> std::string_view { return id < size_ ? std::string_view(chunks_[id / Chunk_Size]->strings[id % Chunk_Size]) : std::string_view{}; }
+
+    auto Intern(std::string_view value) -> uint32_t;
+private:
+    static constexpr uint32_t Chunk_Size = 256;
+
+    struct Chunk {
+        std::array<std::string, Chunk_Size> strings;
+    };
+
+    auto rebuildIndex() -> void;
+
+    std::vector<std::shared_ptr<Chunk>> chunks_;
+    uint32_t size_;
+    bool owns_tail_;        // false for copies, the last chunk is still appended to by the pool it was copied from
+    std::unordered_map<std::string_view, uint32_t> index_;     // not copied, rebuilt by the first Intern() of a copy
+};
\ No newline at end of file
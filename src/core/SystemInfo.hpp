@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+struct CpuCoreInfo {
+    uint32_t core_index;        // logical processor number, offline cores are not listed
+    float busy_percentage;      // time not spent idle, steal time counts as busy
+    float idle_percentage;      // idle and I/O wait
+    uint32_t frequency_mhz;     // current clock, 0 if the platform doesn't report it
+};
+
+// Share of the last tick in which some or all non-idle tasks were stalled on a resource (Linux PSI).
+struct PressureInfo {
+    float some_percentage;
+    float full_percentage;
+};
+
+// Whole block device, partitions and virtual devices (loop, device mapper, ...) are not listed.
+struct DiskInfo {
+    std::string name;               // ie. "nvme0n1" or "0 C:"
+    double read_bytes_per_second;
+    double write_bytes_per_second;
+    float utilization_percentage;   // share of the tick with at least one request in flight
+    float queue_depth;              // average number of requests in flight
+    float latency_ms;               // average time from issuing a request to its completion, 0 without requests
+};
+
+// Temperatures, fans and clocks, zero where no sensor was found.
+struct ThermalInfo {
+    float cpu_temperature;          // C, package or control temperature
+    float gpu_temperature;          // C, edge
+    float gpu_hotspot_temperature;  // C, junction
+    uint32_t fan_rpm;               // fastest fan
+    uint32_t cpu_clock_mhz;         // fastest core, needs Cores to be sampled as well
+    uint32_t cpu_max_clock_mhz;
+    uint32_t gpu_clock_mhz;
+    uint32_t gpu_max_clock_mhz;
+    bool cpu_throttled;             // the CPU reported throttling during the tick or runs at its thermal limit
+    bool gpu_throttled;
+};
+
+// System-wide state sampled next to the process table.
+struct SystemInfo {
+    std::vector<CpuCoreInfo> cores;
+    float max_core_usage;       // busy_percentage of the busiest core, 0 without samples
+    uint32_t max_core_index;
+    PressureInfo cpu_pressure;
+    PressureInfo memory_pressure;
+    PressureInfo io_pressure;
+    bool has_pressure;          // false on Windows and kernels built without PSI
+    size_t swap_total;
+    size_t swap_usage;
+    std::vector<DiskInfo> disks;
+    uint32_t busiest_disk;      // index into disks with the highest utilization, only valid if disks isn't empty
+    ThermalInfo thermal;
+    bool has_thermal;           // false if not a single sensor could be read
+};
\ No newline at end of file
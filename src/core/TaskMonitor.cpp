@@ -1,355 +1,414 @@
 #include "TaskMonitor.hpp"
 
-#include <Windows.h>
-#include <pdh.h>
+#include <algorithm>
 #include <stdexcept>
-#include <PdhMsg.h>
-#include <sstream>
-#include <vector>
-#include <dxgi1_6.h>
-#include <thread>
+#include <stdio.h>
 
-#include <config.hpp>
-
-#pragma comment(lib, "pdh.lib")
-#pragma comment(lib, "dxgi.lib")
+// Exits are reported as they happen, the table retires the process at the next tick or once a zombie is reaped.
+constexpr auto ExitMatchWindow = std::chrono::seconds(10);
 
 TaskMonitor::TaskMonitor()
 {
-    process_list_.clear();
-    process_map_.clear();
-
-    pdh_query_ = { };
-
-    pdh_processes_id_counter_ = { };
-    pdh_dedicated_vram_counter_ = { };
-    pdh_shared_vram_counter_ = { };
-    pdh_gpu_utilization_counter_ = { };
-    pdh_user_process_time_ = { };
-    pdh_kernel_process_time_ = { };
-    pdh_total_process_time_ = { };
-    pdh_process_memory_ = { };
-    system_info_ = { };
-    system_memory_ = { };
-    dxgi_factory_ = nullptr;
-    pdh_available_ = true;
+    snapshot_.store(std::make_shared<const ProcessSnapshot>());
+    recycled_ = nullptr;
+
+    sampler_ = nullptr;
+    system_ = {};
+    interval_ = {};
+    sequence_ = 0;
+
+    for (auto& demand : demand_)
+        demand.store(0);
+
+    session_log_.store(std::make_shared<const SessionLogSnapshot>());
+    exits_.clear();
+    reported_exits_.clear();
+    session_sequence_ = 0;
+
+    focus_snapshot_.store(std::make_shared<const FocusedProcessSnapshot>());
+    focus_pid_.store(0);
+    focus_interval_ = {};
+    focus_sequence_ = 0;
+
+    detail_snapshot_.store(std::make_shared<const MemoryDetailSnapshot>());
+    selected_pid_.store(0);
+    detail_interval_ = {};
+    detail_sequence_ = 0;
 }
 
-auto TaskMonitor::Initialize() -> void
+auto TaskMonitor::Initialize(std::chrono::milliseconds interval, std::chrono::milliseconds focus_interval, std::chrono::milliseconds detail_interval) -> void
 {
-    PDH_STATUS result = {};
+    Initialize(ProcessSampler::Create(), interval, focus_interval, detail_interval);
+}
 
-    try {
-        result = PdhOpenQueryA(NULL, 0, &pdh_query_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to open query through PdhOpenQueryA");
+auto TaskMonitor::Initialize(std::unique_ptr<ProcessSampler> sampler, std::chrono::milliseconds interval, std::chrono::milliseconds focus_interval, std::chrono::milliseconds detail_interval) -> void
+{
+    interval_ = interval;
+    focus_interval_ = focus_interval;
+    detail_interval_ = detail_interval;
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Id Process", 0, &pdh_processes_id_counter_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Id Process) through PdhAddCounterA");
+    sampler_ = std::move(sampler);
+    if (sampler_ == nullptr || !sampler_->Initialize()) {
+        sampler_.reset();
+        return;
+    }
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\GPU Process Memory(*)\\Dedicated Usage", 0, &pdh_dedicated_vram_counter_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Dedicated Usage) through PdhAddCounterA");
+    sampling_thread_ = std::jthread([this](std::stop_token stop_token) { samplingLoop(stop_token); });
+    focus_thread_ = std::jthread([this](std::stop_token stop_token) { focusLoop(stop_token); });
+    detail_thread_ = std::jthread([this](std::stop_token stop_token) { detailLoop(stop_token); });
+}
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\GPU Process Memory(*)\\Shared Usage", 0, &pdh_shared_vram_counter_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Shared Usage) through PdhAddCounterA");
+auto TaskMonitor::Destroy() -> void
+{
+    if (sampling_thread_.joinable()) {
+        sampling_thread_.request_stop();
+        sampling_cv_.notify_all();
+        sampling_thread_.join();
+    }
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\GPU Engine(*)\\Utilization Percentage", 0, &pdh_gpu_utilization_counter_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Utilization Percentage) through PdhAddCounterA");
+    if (focus_thread_.joinable()) {
+        focus_thread_.request_stop();
+        focus_cv_.notify_all();
+        focus_thread_.join();
+    }
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% User Time", 0, &pdh_user_process_time_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (User Time) through PdhAddCounterA");
+    if (detail_thread_.joinable()) {
+        detail_thread_.request_stop();
+        detail_cv_.notify_all();
+        detail_thread_.join();
+    }
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% Privileged Time", 0, &pdh_kernel_process_time_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Privileged Time) through PdhAddCounterA");
+    if (sampler_ != nullptr)
+        sampler_->Destroy();
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% Processor Time", 0, &pdh_total_process_time_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Processor Time) through PdhAddCounterA");
+    sampler_.reset();
+    recycled_.reset();
+}
 
-        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Working Set", 0, &pdh_process_memory_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to register counter (Processor Time) through PdhAddCounterA");
-    }
-    catch (std::exception& ex) {
-#ifdef _WIN32
-        char error_message[512] = {};
-        snprintf(error_message, 512, "Failed to initialize PDH, this means you will not be able to get performnce statistics, other systems continue to operate.\n\n%s\r\n", ex.what());
-        MessageBoxA(NULL, error_message, APP_NAME, MB_OK);
-#endif
-        printf("%s\n\n", ex.what());
-        pdh_available_ = false;
+auto TaskMonitor::Subscribe(uint32_t metric_groups) -> void
+{
+    bool woke = false;
+    for (uint32_t i = 0; i < MetricGroup_Count; ++i) {
+        if (metric_groups & (1u << i))
+            woke |= demand_[i].fetch_add(1, std::memory_order_acq_rel) == 0;
     }
 
-    GetSystemInfo(&system_info_);
-    system_memory_.dwLength = sizeof(system_memory_);
-    GlobalMemoryStatusEx(&system_memory_);
-    CreateDXGIFactory1(__uuidof(IDXGIFactory6), (void**)&dxgi_factory_);
+    // A group nobody consumed before is sampled right away instead of waiting for the next tick.
+    if (woke) {
+        {
+            std::lock_guard lock(sampling_mutex_);
+            sampling_cv_.notify_all();
+        }
+        {
+            std::lock_guard lock(focus_mutex_);
+            focus_cv_.notify_all();
+        }
+        notifyDetail();
+    }
 }
 
-auto TaskMonitor::Destroy() -> void
+auto TaskMonitor::SetFocusPid(uint32_t pid) -> void
 {
-    PdhCloseQuery(pdh_query_);
-
-    PdhRemoveCounter(pdh_processes_id_counter_);
-    PdhRemoveCounter(pdh_dedicated_vram_counter_);
-    PdhRemoveCounter(pdh_shared_vram_counter_);
-    PdhRemoveCounter(pdh_gpu_utilization_counter_);
-    PdhRemoveCounter(pdh_user_process_time_);
-    PdhRemoveCounter(pdh_kernel_process_time_);
-    PdhRemoveCounter(pdh_total_process_time_);
-    PdhRemoveCounter(pdh_process_memory_);
-
-    system_info_ = { };
-    system_memory_ = { };
-    dxgi_factory_->Release();
+    if (focus_pid_.exchange(pid, std::memory_order_acq_rel) == pid)
+        return;
+
+    {
+        std::lock_guard lock(focus_mutex_);
+        focus_cv_.notify_all();
+    }
+    notifyDetail();
 }
 
-auto TaskMonitor::Update() -> void
+auto TaskMonitor::SetSelectedPid(uint32_t pid) -> void
 {
-    if (!pdh_available_)
-        return;
-
-    process_list_.clear();
-    process_map_.clear();
+    if (selected_pid_.exchange(pid, std::memory_order_acq_rel) != pid)
+        notifyDetail();
+}
 
-    PDH_STATUS result = {};
+auto TaskMonitor::notifyDetail() -> void
+{
+    std::lock_guard lock(detail_mutex_);
+    detail_cv_.notify_all();
+}
 
-    try {
-        result = PdhCollectQueryData(pdh_query_);
-        if (result != ERROR_SUCCESS)
-            throw std::runtime_error("Failed to collect query data through PdhCollectQueryData");
-    }
-    catch (std::exception& ex) {
-#ifdef _WIN32
-        char error_message[512] = {};
-        snprintf(error_message, 512, "Failed to collect PDH counters.\nReason: %s\r\n", ex.what());
-        MessageBoxA(NULL, error_message, APP_NAME, MB_OK);
-#endif
-        printf("%s\n\n", ex.what());
-        return;
+auto TaskMonitor::Unsubscribe(uint32_t metric_groups) -> void
+{
+    for (uint32_t i = 0; i < MetricGroup_Count; ++i) {
+        if (metric_groups & (1u << i))
+            demand_[i].fetch_sub(1, std::memory_order_acq_rel);
     }
+}
 
-    mapProcessesToPid(pdh_processes_id_counter_);
-
-    calculateGpuMetricFromCounter(pdh_dedicated_vram_counter_, GpuMetric_Dedicated_Vram);
-    calculateGpuMetricFromCounter(pdh_shared_vram_counter_, GpuMetric_Shared_Vram);
-    calculateGpuMetricFromCounter(pdh_gpu_utilization_counter_, GpuMetric_Engine_Utilization);
+auto TaskMonitor::ActiveMetricGroups() const -> uint32_t
+{
+    uint32_t metric_groups = MetricGroup_None;
+    for (uint32_t i = 0; i < MetricGroup_Count; ++i) {
+        if (demand_[i].load(std::memory_order_acquire) > 0)
+            metric_groups |= (1u << i);
+    }
+    return metric_groups;
+}
 
-    calculateCpuMetricFromCounter(pdh_user_process_time_, CpuMetric_User_Time);
-    calculateCpuMetricFromCounter(pdh_kernel_process_time_, CpuMetric_Priviledged_Time);
-    calculateCpuMetricFromCounter(pdh_total_process_time_, CpuMetric_Total_Time);
+auto TaskMonitor::samplingLoop(std::stop_token stop_token) -> void
+{
+    // After being idle the CPU counters average over the whole pause, the tick
+    // following a resume comes early so consumers get current values right away.
+    constexpr auto warm_up_interval = std::chrono::milliseconds(100);
+
+    // Ticks are scheduled against absolute deadlines so the collection time
+    // does not accumulate into the sampling period.
+    auto next_tick = std::chrono::steady_clock::now();
+    bool resumed = true;
+
+    while (!stop_token.stop_requested()) {
+        const uint32_t metric_groups = ActiveMetricGroups();
+
+        if (metric_groups == MetricGroup_None) {
+            std::unique_lock lock(sampling_mutex_);
+            sampling_cv_.wait(lock, stop_token, [this] { return ActiveMetricGroups() != MetricGroup_None; });
+            next_tick = std::chrono::steady_clock::now();
+            resumed = true;
+            continue;
+        }
 
-    calculateMemoryMetricFromCounter(pdh_process_memory_);
+        try {
+            table_.BeginTick();
+            sampler_->Sample(table_, metric_groups);
+            table_.EndTick();
+            logExits();
+            tree_.Apply(table_);
+            sampler_->SampleSystem(system_, metric_groups);
+            publish();
+        }
+        catch (const std::exception& ex) {
+            // keep the previous snapshot, the next tick may succeed and report the deltas of both.
+            printf("%s\n\n", ex.what());
+        }
 
-    for (auto it = process_list_.begin(); it != process_list_.end(); ) {
-        // If the process name is empty but allocates VRAM it's an system process
-        // it's removed because Task Manager removes these processes as well.
-        if (it->second.process_name.empty() || it->second.process_name.find("Idle") != std::string::npos || it->second.process_name.find("_Total") != std::string::npos) {
-            it = process_list_.erase(it);
+        if (resumed) {
+            next_tick = std::chrono::steady_clock::now() + std::min<std::chrono::milliseconds>(interval_, warm_up_interval);
+            resumed = false;
         }
         else {
-            ++it;
-        }
-    }
+            next_tick += interval_;
 
-    for (auto& [pid, process] : process_list_) {
-        for (auto& [index, info] : process.gpus) {
-            IDXGIAdapter1* adapter = nullptr;
-            if (SUCCEEDED(dxgi_factory_->EnumAdapters1(index, &adapter))) {
-                DXGI_ADAPTER_DESC1 desc = {};
-                if (SUCCEEDED(adapter->GetDesc1(&desc))) {
-                    info.memory.dedicated_available = desc.DedicatedVideoMemory;
-                    info.memory.shared_available = desc.SharedSystemMemory;
-                }
-                adapter->Release();
-            }
+            // If a collection overran one or more periods skip them instead of bursting to catch up.
+            const auto now = std::chrono::steady_clock::now();
+            if (next_tick <= now)
+                next_tick += ((now - next_tick) / interval_ + 1) * interval_;
         }
 
-        process.cpu.user_cpu_usage /= system_info_.dwNumberOfProcessors;
-        process.cpu.kernel_cpu_usage /= system_info_.dwNumberOfProcessors;
-        process.cpu.total_cpu_usage /= system_info_.dwNumberOfProcessors;
-        process.memory_available = system_memory_.ullTotalPhys;
+        std::unique_lock lock(sampling_mutex_);
+        const bool new_demand = sampling_cv_.wait_until(lock, stop_token, next_tick, [this, metric_groups] {
+            return (ActiveMetricGroups() & ~metric_groups) != MetricGroup_None;
+        });
+
+        if (new_demand)
+            next_tick = std::chrono::steady_clock::now();
     }
 }
 
-auto TaskMonitor::GetProcessInfoByPid(uint32_t pid) -> ProcessInfo
+auto TaskMonitor::focusLoop(std::stop_token stop_token) -> void
 {
-    return process_list_[pid];
-}
+    constexpr uint32_t focus_groups = MetricGroup_Cpu | MetricGroup_Memory;
 
-auto TaskMonitor::mapProcessesToPid(PDH_HCOUNTER counter) -> void
-{
-    PDH_STATUS result = {};
+    auto next_tick = std::chrono::steady_clock::now();
 
-    DWORD bufferSize = 0;
-    DWORD itemCount = 0;
+    while (!stop_token.stop_requested()) {
+        const uint32_t pid = focus_pid_.load(std::memory_order_acquire);
+        const uint32_t metric_groups = ActiveMetricGroups() & focus_groups;
 
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, nullptr);
-    if (result != PDH_MORE_DATA)
-        throw std::runtime_error("Failed to get formatted counter array size (Dedicated Usage) through PdhGetFormattedCounterArrayA");
+        if (pid == 0 || metric_groups == MetricGroup_None) {
+            std::unique_lock lock(focus_mutex_);
+            focus_cv_.wait(lock, stop_token, [this] {
+                return focus_pid_.load(std::memory_order_acquire) != 0 && (ActiveMetricGroups() & focus_groups) != MetricGroup_None;
+            });
+            next_tick = std::chrono::steady_clock::now();
+            continue;
+        }
 
-    std::vector<std::byte> buffer(bufferSize);
-    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, items);
+        try {
+            // A failed sample is still published with pid 0 so readers stop showing the previous process.
+            auto snapshot = std::make_shared<FocusedProcessSnapshot>();
+            if (sampler_->SampleFocus(pid, snapshot->process, metric_groups)) {
+                snapshot->pid = pid;
+                if (metric_groups & MetricGroup_Cpu)
+                    sampler_->SampleThreads(pid, snapshot->threads, FocusThread_Count, snapshot->scheduler);
+            }
+            snapshot->timestamp = std::chrono::steady_clock::now();
+            snapshot->sequence = ++focus_sequence_;
 
-    for (DWORD i = 0; i < itemCount; ++i) {
-        if (items != nullptr && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
-            uint32_t pid = static_cast<uint32_t>(items[i].FmtValue.largeValue);
-            process_list_[pid].process_name = items[i].szName;
-            process_map_[items[i].szName] = pid;
+            focus_snapshot_.store(std::move(snapshot), std::memory_order_release);
+        }
+        catch (const std::exception& ex) {
+            printf("%s\n\n", ex.what());
         }
+
+        next_tick += focus_interval_;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (next_tick <= now)
+            next_tick += ((now - next_tick) / focus_interval_ + 1) * focus_interval_;
+
+        std::unique_lock lock(focus_mutex_);
+        const bool refocused = focus_cv_.wait_until(lock, stop_token, next_tick, [this, pid] {
+            return focus_pid_.load(std::memory_order_acquire) != pid;
+        });
+
+        if (refocused)
+            next_tick = std::chrono::steady_clock::now();
     }
 }
 
-auto TaskMonitor::calculateGpuMetricFromCounter(PDH_HCOUNTER counter, GpuMetric_Type type) -> void
+auto TaskMonitor::detailLoop(std::stop_token stop_token) -> void
 {
-    PDH_STATUS result = {};
-
-    auto parseCounterToStruct = [&](const std::string& name, LONGLONG& value) -> void {
-        std::stringstream stream(name);
-        std::string token;
-        std::vector<std::string> tokens;
-
-        while (std::getline(stream, token, '_'))
-            tokens.push_back(token);
+    auto wanted_pids = [this]() -> std::array<uint32_t, 2> {
+        if (!(ActiveMetricGroups() & MetricGroup_Memory))
+            return {};
+        return { focus_pid_.load(std::memory_order_acquire), selected_pid_.load(std::memory_order_acquire) };
+    };
 
-        uint32_t pid = 0;
-        uint32_t engine_index = 0;
-        int gpu_index = 0;
+    auto next_tick = std::chrono::steady_clock::now();
 
-        uint32_t luid_low = 0;
-        uint32_t luid_high = 0;
-        std::string engine_type;
+    while (!stop_token.stop_requested()) {
+        const std::array<uint32_t, 2> pids = wanted_pids();
 
-        for (size_t i = 0; i < tokens.size(); ++i) {
-            if (tokens[i] == "pid") {
-                pid = std::stoul(tokens[++i]);
-            }
-            else if (tokens[i] == "luid") {
-                luid_low = static_cast<uint32_t>(std::stoul(tokens[++i], nullptr, 16));
-                luid_high = static_cast<uint32_t>(std::stoull(tokens[++i], nullptr, 16));
-            }
-            else if (tokens[i] == "phys") {
-                gpu_index = std::stoi(tokens[++i]);
-            }
-            else if (tokens[i] == "eng") {
-                engine_index = std::stoi(tokens[++i]);
-            }
-            else if (tokens[i] == "engtype") {
-                engine_type = tokens[++i];
-            }
+        if (pids[0] == 0 && pids[1] == 0) {
+            std::unique_lock lock(detail_mutex_);
+            detail_cv_.wait(lock, stop_token, [&] {
+                const std::array<uint32_t, 2> wanted = wanted_pids();
+                return wanted[0] != 0 || wanted[1] != 0;
+            });
+            next_tick = std::chrono::steady_clock::now();
+            continue;
         }
 
-        auto& gpu = process_list_[pid].gpus[gpu_index];
-
-        gpu.gpu_index = gpu_index;
+        try {
+            // Walking the mappings of a large process takes milliseconds, which is why this has its own thread.
+            auto snapshot = std::make_shared<MemoryDetailSnapshot>();
+            for (uint32_t pid : pids) {
+                MemoryDetail detail = {};
+                if (pid != 0 && snapshot->Find(pid) == nullptr && sampler_->SampleMemoryDetail(pid, detail))
+                    snapshot->processes.push_back(detail);
+            }
+            snapshot->timestamp = std::chrono::steady_clock::now();
+            snapshot->sequence = ++detail_sequence_;
 
-        gpu.luid.low = luid_low;
-        gpu.luid.high = luid_high;
+            detail_snapshot_.store(std::move(snapshot), std::memory_order_release);
+        }
+        catch (const std::exception& ex) {
+            printf("%s\n\n", ex.what());
+        }
 
-        auto& eng = gpu.engines[engine_index];
-        eng.engine_index = engine_index;
+        next_tick += detail_interval_;
 
-        if (!engine_type.empty())
-            eng.engine_type = engine_type;
+        const auto now = std::chrono::steady_clock::now();
+        if (next_tick <= now)
+            next_tick += ((now - next_tick) / detail_interval_ + 1) * detail_interval_;
 
-        switch (type)
-        {
-        case GpuMetric_Dedicated_Vram:
-            gpu.memory.dedicated_vram_usage = static_cast<size_t>(value);
-            break;
+        // A newly focused or selected process is sampled right away instead of at the next tick.
+        std::unique_lock lock(detail_mutex_);
+        const bool changed = detail_cv_.wait_until(lock, stop_token, next_tick, [&] { return wanted_pids() != pids; });
 
-        case GpuMetric_Shared_Vram:
-            gpu.memory.shared_vram_usage = static_cast<size_t>(value);
-            break;
+        if (changed)
+            next_tick = std::chrono::steady_clock::now();
+    }
+}
 
-        case GpuMetric_Engine_Utilization:
-            eng.utilization_percentage = static_cast<float>(value);
-            break;
+auto TaskMonitor::logExits() -> void
+{
+    sampler_->TakeExits(reported_exits_);
+    exits_.insert(exits_.end(), reported_exits_.begin(), reported_exits_.end());
+
+    const auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<SessionLogSnapshot> log = nullptr;
+
+    // Retired rows are gone from the table, the snapshot published last tick still has their names.
+    const ProcessSnapshotHandle previous = Snapshot();
+    for (uint32_t pid : table_.Removed()) {
+        const ProcessInfo* process = previous->Find(pid);
+        if (process == nullptr)
+            continue;
+
+        if (log == nullptr)
+            log = std::make_shared<SessionLogSnapshot>(*SessionLog());
+
+        SessionExitRecord& record = log->exits.emplace_back();
+        record.pid = pid;
+        record.parent_pid = process->parent_pid;
+        record.name = previous->Name(*process);
+        record.exit_time = now;
+        record.exit_code = 0;
+        record.signal = 0;
+        record.has_status = false;
+        record.exact = false;
+
+        // The oldest exit of the pid belongs to the retired process if the pid was reused since.
+        auto exit = std::ranges::find(exits_, pid, &ProcessExit::pid);
+        if (exit != exits_.end()) {
+            record.exit_time = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(exit->exit_time));
+            record.exit_code = exit->exit_code;
+            record.signal = exit->signal;
+            record.has_status = exit->has_status;
+            record.exact = true;
+            exits_.erase(exit);
         }
-    };
 
-    DWORD bufferSize = 0;
-    DWORD itemCount = 0;
+        ++log->exit_count;
+    }
 
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, nullptr);
-    if (result != PDH_MORE_DATA)
-        throw std::runtime_error("Failed to get formatted counter array size (Dedicated Usage) through PdhGetFormattedCounterArrayA");
+    // Kernel threads and processes that lived shorter than a tick never made it into the table.
+    std::erase_if(exits_, [now](const ProcessExit& exit) {
+        return now - std::chrono::steady_clock::time_point(std::chrono::nanoseconds(exit.exit_time)) > ExitMatchWindow;
+    });
 
-    std::vector<std::byte> buffer(bufferSize);
-    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, items);
+    if (log == nullptr)
+        return;
 
-    for (DWORD i = 0; i < itemCount; ++i) {
-        if (items != NULL && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
-            parseCounterToStruct(items[i].szName, items[i].FmtValue.largeValue);
-        }
-    }
+    if (log->exits.size() > SessionLog_Capacity)
+        log->exits.erase(log->exits.begin(), log->exits.end() - SessionLog_Capacity);
+    log->sequence = ++session_sequence_;
+
+    session_log_.store(std::move(log), std::memory_order_release);
 }
 
-auto TaskMonitor::calculateCpuMetricFromCounter(PDH_HCOUNTER counter, CpuMetric_Type type) -> void
+auto TaskMonitor::publish() -> void
 {
-    PDH_STATUS result = {};
-
-    DWORD bufferSize = 0;
-    DWORD itemCount = 0;
-
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, nullptr);
-    if (result != PDH_MORE_DATA)
-        throw std::runtime_error("Failed to get formatted counter array size (Dedicated Usage) through PdhGetFormattedCounterArrayA");
-
-    std::vector<std::byte> buffer(bufferSize);
-    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, items);
-
-    for (DWORD i = 0; i < itemCount; ++i) {
-        if (items != nullptr && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
-            uint32_t pid = process_map_[items[i].szName];
-            if (strcmp(items[i].szName, "Idle") != 0 && strcmp(items[i].szName, "_Total") != 0) {
-                switch (type)
-                {
-                case CpuMetric_User_Time:
-                    process_list_[pid].cpu.user_cpu_usage = items[i].FmtValue.doubleValue;
-                    break;
-                case CpuMetric_Priviledged_Time:
-                    process_list_[pid].cpu.kernel_cpu_usage = items[i].FmtValue.doubleValue;
-                    break;
-                case CpuMetric_Total_Time:
-                    process_list_[pid].cpu.total_cpu_usage = items[i].FmtValue.doubleValue;
-                    break;
-                }
-            }
-        }
+    // The snapshot replaced last tick is reused once no reader holds it anymore,
+    // copy-assigning into it keeps the allocations of its rows.
+    std::shared_ptr<ProcessSnapshot> snapshot = nullptr;
+    if (recycled_ != nullptr && recycled_.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        snapshot = std::const_pointer_cast<ProcessSnapshot>(std::move(recycled_));
     }
+    else {
+        snapshot = std::make_shared<ProcessSnapshot>();
+    }
+
+    snapshot->table = table_;
+    snapshot->columns.Build(snapshot->table);
+    snapshot->tree = tree_;
+    snapshot->system = system_;
+    snapshot->timestamp = std::chrono::steady_clock::now();
+    snapshot->sequence = ++sequence_;
+
+    recycled_ = snapshot_.exchange(std::move(snapshot), std::memory_order_acq_rel);
 }
 
-auto TaskMonitor::calculateMemoryMetricFromCounter(PDH_HCOUNTER counter) -> void
+MetricSubscription::MetricSubscription()
 {
-    PDH_STATUS result = {};
-
-    DWORD bufferSize = 0;
-    DWORD itemCount = 0;
+    metric_groups_ = MetricGroup_None;
+}
 
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, nullptr);
-    if (result != PDH_MORE_DATA)
-        throw std::runtime_error("Failed to get formatted counter array size (Working Set) through PdhGetFormattedCounterArrayA");
+auto MetricSubscription::Update(uint32_t metric_groups) -> void
+{
+    const uint32_t added = metric_groups & ~metric_groups_;
+    const uint32_t removed = metric_groups_ & ~metric_groups;
 
-    std::vector<std::byte> buffer(bufferSize);
-    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
-    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, items);
+    if (added != MetricGroup_None)
+        g_taskMonitor->Subscribe(added);
+    if (removed != MetricGroup_None)
+        g_taskMonitor->Unsubscribe(removed);
 
-    for (DWORD i = 0; i < itemCount; ++i) {
-        if (items != nullptr && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
-            uint32_t pid = process_map_[items[i].szName];
-            if (strcmp(items[i].szName, "Idle") != 0 && strcmp(items[i].szName, "_Total") != 0) {
-                process_list_[pid].memory_usage = static_cast<size_t>(items[i].FmtValue.doubleValue);
-            }
-        }
-    }
-}
+    metric_groups_ = metric_groups;
+}
\ No newline at end of file
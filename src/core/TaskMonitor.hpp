@@ -1,137 +1,188 @@
 #pragma once
 
-#include <Windows.h>
-#include <pdh.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 #include <stdint.h>
-#include <dxgi1_6.h>
-#include <ranges>
 
-struct GpuEngine {
-    uint32_t engine_index;
-	std::string engine_type;
-    float utilization_percentage;
-};
+#include <core/ProcessColumns.hpp>
+#include <core/ProcessInfo.hpp>
+#include <core/ProcessSampler.hpp>
+#include <core/ProcessTable.hpp>
+#include <core/ProcessTree.hpp>
+#include <core/SystemInfo.hpp>
 
-struct VRAMInfo {
-    size_t dedicated_vram_usage;
-    size_t shared_vram_usage;
-    size_t dedicated_available;
-    size_t shared_available;
-};
+// Result of a single sampler tick, never modified after it has been published.
+// table carries the pids added, removed and changed since the previous sequence,
+// columns holds the same rows laid out for sorting and scanning.
+struct ProcessSnapshot {
+    ProcessTable table;
+    ProcessColumns columns;
+    ProcessTree tree;
+    SystemInfo system;
+    std::chrono::steady_clock::time_point timestamp;
+    uint64_t sequence;
 
-struct GpuInfo {
-    struct {
-        uint32_t low;
-        uint64_t high;
-    } luid;
-    uint32_t gpu_index;
-    std::unordered_map<uint64_t, GpuEngine> engines;
-    VRAMInfo memory;
-};
+    [[nodiscard]] auto Size() const -> size_t { return table.Size(); }
+    [[nodiscard]] auto Rows() const { return table.Rows(); }
 
-struct ProcessInfo {
-    uint32_t pid;
-    std::string process_name;
-    std::unordered_map<uint32_t, GpuInfo> gpus;
-    size_t memory_usage;
-    size_t memory_available; // system ram
-    struct {
-        double user_cpu_usage;
-        double kernel_cpu_usage;
-        double total_cpu_usage;
-    } cpu;
-};
+    // Returns nullptr for pids that were not alive during this tick.
+    [[nodiscard]] auto Find(uint32_t pid) const -> const ProcessInfo* { return table.Find(pid); }
+    [[nodiscard]] auto Name(const ProcessInfo& process) const -> std::string_view { return table.String(process.name_id); }
 
-enum GpuMetric_Type : uint8_t {
-    GpuMetric_Unknown = 0,
-    GpuMetric_Dedicated_Vram = 1,
-    GpuMetric_Shared_Vram = 2,
-    GpuMetric_Engine_Utilization = 3,
+    // Walks the tree, callers should keep the result for as long as they hold the snapshot.
+    [[nodiscard]] auto Rollup(uint32_t pid) const -> ProcessRollup { return tree.Rollup(pid, table); }
 };
 
-enum CpuMetric_Type : uint8_t {
-    CpuMetric_Unknown = 0,
-    CpuMetric_User_Time = 1,
-    CpuMetric_Priviledged_Time = 2,
-    CpuMetric_Total_Time = 3,
-};
+constexpr size_t FocusThread_Count = 4;
 
-inline auto getCurrentlyUsedGpu = [](const ProcessInfo& info) -> GpuInfo 
-{
-    auto gpuIt = std::ranges::find_if(info.gpus, [](auto& gpuEntry) {
-        auto& [gpuId, gpu] = gpuEntry;
-        return std::ranges::find_if(gpu.engines, [](auto& engEntry) {
-            const auto& [idx, eng] = engEntry;
-            return eng.engine_type == "3D" && eng.utilization_percentage > 0.0f;
-        }) != gpu.engines.end();
-    });
-
-    return gpuIt != info.gpus.end()
-        ? 
-        gpuIt->second
-        : GpuInfo{};
+// Result of a focused tick, only covers the process set through TaskMonitor::SetFocusPid().
+struct FocusedProcessSnapshot {
+    uint32_t pid;           // 0 if the process could not be sampled
+    ProcessInfo process;    // name_id and gpus are not filled, read them from ProcessSnapshot
+    std::vector<ThreadInfo> threads;    // busiest first, at most FocusThread_Count, only while Cpu is subscribed
+    SchedulerInfo scheduler;            // over all threads of the process, only while Cpu is subscribed
+    std::chrono::steady_clock::time_point timestamp;
+    uint64_t sequence;
 };
 
-inline auto gpuPercentage = [](const GpuInfo& gpu) -> float
-{
-    if (auto it = std::ranges::find_if(gpu.engines,
-        [](const auto& pair) {
-            const auto& [key, eng] = pair;
-            return eng.engine_type == "3D" &&
-                eng.utilization_percentage > 0.0f;
-        });
-        it != gpu.engines.end())
-    {
-        return it->second.utilization_percentage;
+// PSS/USS of the focused and the selected process, refreshed at the detail interval.
+struct MemoryDetailSnapshot {
+    std::vector<MemoryDetail> processes;
+    std::chrono::steady_clock::time_point timestamp;
+    uint64_t sequence;
+
+    // Returns nullptr for pids that are neither focused nor selected, or that could not be sampled.
+    [[nodiscard]] auto Find(uint32_t pid) const -> const MemoryDetail* {
+        auto it = std::ranges::find(processes, pid, &MemoryDetail::pid);
+        return it != processes.end() ? &*it : nullptr;
     }
-    return 0.0f;
 };
 
-inline auto gpuVideoPercentage = [](const GpuInfo& gpu) -> float
-{
-    if (auto it = std::ranges::find_if(gpu.engines,
-        [](const auto& pair) {
-            const auto& [key, eng] = pair;
-            return eng.engine_type.find("Encode") != std::string::npos || eng.engine_type.find("Codec") != std::string::npos && eng.utilization_percentage > 0.0f;
-        });
-        it != gpu.engines.end())
-    {
-        return it->second.utilization_percentage;
-    }
-    return 0.0f;
+// A process that exited while the overlay was running.
+struct SessionExitRecord {
+    uint32_t pid;
+    uint32_t parent_pid;
+    std::string name;
+    std::chrono::steady_clock::time_point exit_time;
+    int32_t exit_code;
+    int32_t signal;
+    bool has_status;    // exit_code and signal were reported by the sampler
+    bool exact;         // exit_time was reported by the sampler, otherwise it's the tick that no longer found the process
+};
+
+constexpr size_t SessionLog_Capacity = 512;
+
+// Processes of the table that exited since TaskMonitor was initialized, oldest first.
+// Only the last SessionLog_Capacity are kept, a new snapshot is only published when one exits.
+struct SessionLogSnapshot {
+    std::vector<SessionExitRecord> exits;
+    uint64_t exit_count;    // including the ones no longer kept
+    uint64_t sequence;
 };
 
+// Readers keep the handle for as long as they use the rows, holding it never blocks the sampler.
+using ProcessSnapshotHandle = std::shared_ptr<const ProcessSnapshot>;
+
+// Process-wide sampling service, overlays subscribe to the metric groups they
+// display and every group is collected once per tick regardless of the number of consumers.
 class TaskMonitor {
 public:
     explicit TaskMonitor();
 
-    [[nodiscard]] auto Processes() const -> std::unordered_map<uint32_t, ProcessInfo> { return process_list_; }
+    // Latest published sample, safe to call from any thread and never blocks on collection.
+    [[nodiscard]] auto Snapshot() const -> ProcessSnapshotHandle { return snapshot_.load(std::memory_order_acquire); }
+    [[nodiscard]] auto FocusSnapshot() const -> std::shared_ptr<const FocusedProcessSnapshot> { return focus_snapshot_.load(std::memory_order_acquire); }
+    [[nodiscard]] auto MemoryDetails() const -> std::shared_ptr<const MemoryDetailSnapshot> { return detail_snapshot_.load(std::memory_order_acquire); }
+    [[nodiscard]] auto SessionLog() const -> std::shared_ptr<const SessionLogSnapshot> { return session_log_.load(std::memory_order_acquire); }
+
+    // interval is the period of the full process list, focus_interval the one of the focused process
+    // and detail_interval the one of the memory details of the focused and selected process.
+    auto Initialize(
+        std::chrono::milliseconds interval = std::chrono::milliseconds(500),
+        std::chrono::milliseconds focus_interval = std::chrono::milliseconds(25),
+        std::chrono::milliseconds detail_interval = std::chrono::milliseconds(2000)) -> void;
 
-    auto Initialize() -> void;
+    // Samples through sampler instead of the platform backend, ie. a ReplayProcessSampler.
+    auto Initialize(
+        std::unique_ptr<ProcessSampler> sampler,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(500),
+        std::chrono::milliseconds focus_interval = std::chrono::milliseconds(25),
+        std::chrono::milliseconds detail_interval = std::chrono::milliseconds(2000)) -> void;
     auto Destroy() -> void;
-    auto Update() -> void;
-	auto GetProcessInfoByPid(uint32_t pid) -> ProcessInfo;
+
+    // Samples pid on its own at focus_interval while Cpu or Memory are subscribed, 0 stops focused sampling.
+    auto SetFocusPid(uint32_t pid) -> void;
+
+    // Process picked in a list, its memory details are sampled next to the focused one while Memory is subscribed. 0 clears it.
+    auto SetSelectedPid(uint32_t pid) -> void;
+
+    // metric_groups is a combination of MetricGroup_Flags, every Subscribe must be paired with an Unsubscribe.
+    auto Subscribe(uint32_t metric_groups) -> void;
+    auto Unsubscribe(uint32_t metric_groups) -> void;
+    [[nodiscard]] auto ActiveMetricGroups() const -> uint32_t;
+private:
+    auto samplingLoop(std::stop_token stop_token) -> void;
+    auto focusLoop(std::stop_token stop_token) -> void;
+    auto detailLoop(std::stop_token stop_token) -> void;
+    auto notifyDetail() -> void;
+    auto logExits() -> void;
+    auto publish() -> void;
+
+    std::atomic<ProcessSnapshotHandle> snapshot_;
+    ProcessSnapshotHandle recycled_;
+    std::unique_ptr<ProcessSampler> sampler_;
+    ProcessTable table_;
+    ProcessTree tree_;
+    SystemInfo system_;
+    std::chrono::milliseconds interval_;
+    std::jthread sampling_thread_;
+    std::mutex sampling_mutex_;
+    std::condition_variable_any sampling_cv_;
+    std::array<std::atomic<uint32_t>, MetricGroup_Count> demand_;
+    uint64_t sequence_;
+
+    std::atomic<std::shared_ptr<const SessionLogSnapshot>> session_log_;
+    std::vector<ProcessExit> exits_;            // reported by the sampler, kept until the table retires the process
+    std::vector<ProcessExit> reported_exits_;
+    uint64_t session_sequence_;
+
+    std::atomic<std::shared_ptr<const FocusedProcessSnapshot>> focus_snapshot_;
+    std::atomic<uint32_t> focus_pid_;
+    std::chrono::milliseconds focus_interval_;
+    std::jthread focus_thread_;
+    std::mutex focus_mutex_;
+    std::condition_variable_any focus_cv_;
+    uint64_t focus_sequence_;
+
+    std::atomic<std::shared_ptr<const MemoryDetailSnapshot>> detail_snapshot_;
+    std::atomic<uint32_t> selected_pid_;
+    std::chrono::milliseconds detail_interval_;
+    std::jthread detail_thread_;
+    std::mutex detail_mutex_;
+    std::condition_variable_any detail_cv_;
+    uint64_t detail_sequence_;
+};
+
+// Tracks the metric groups one consumer currently subscribes to on g_taskMonitor,
+// so overlays can follow their visibility without pairing Subscribe/Unsubscribe by hand.
+class MetricSubscription {
+public:
+    explicit MetricSubscription();
+
+    [[nodiscard]] auto MetricGroups() const -> uint32_t { return metric_groups_; }
+
+    // Subscribes to the groups that were not requested before and releases the ones no longer requested.
+    auto Update(uint32_t metric_groups) -> void;
 private:
-    auto mapProcessesToPid(PDH_HCOUNTER counter) -> void;
-    auto calculateGpuMetricFromCounter(PDH_HCOUNTER counter, GpuMetric_Type type) -> void;
-    auto calculateCpuMetricFromCounter(PDH_HCOUNTER counter, CpuMetric_Type type) -> void;
-    auto calculateMemoryMetricFromCounter(PDH_HCOUNTER counter) -> void;
-
-    std::unordered_map<uint32_t, ProcessInfo> process_list_;
-    std::unordered_map<std::string, uint32_t> process_map_;
-    PDH_HQUERY pdh_query_;
-    PDH_HCOUNTER pdh_processes_id_counter_;
-	PDH_HCOUNTER pdh_dedicated_vram_counter_;
-    PDH_HCOUNTER pdh_shared_vram_counter_;
-	PDH_HCOUNTER pdh_gpu_utilization_counter_;
-	PDH_HCOUNTER pdh_user_process_time_;
-    PDH_HCOUNTER pdh_kernel_process_time_;
-    PDH_HCOUNTER pdh_total_process_time_;
-    PDH_HCOUNTER pdh_process_memory_;
-    SYSTEM_INFO system_info_;
-    MEMORYSTATUSEX system_memory_;
-    IDXGIFactory6* dxgi_factory_;
-    bool pdh_available_;
-};
\ No newline at end of file
+    uint32_t metric_groups_;
+};
+
+extern TaskMonitor* g_taskMonitor;
\ No newline at end of file
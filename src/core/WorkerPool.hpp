@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Threads kept alive by a sampler to spread the work of a tick, so a tick costs
+// a wake-up per worker instead of creating and joining threads. Idle workers
+// block on a condition variable and cost nothing between ticks.
+//
+// For() calls fn(index) for every index in [0, count), the calling thread
+// included. Indices are handed out one at a time so uneven work balances itself,
+// callers that need a deterministic result write into a slot per index and
+// merge the slots in order afterwards. fn must not throw. Only one thread may
+// call For() at a time.
+class WorkerPool {
+public:
+    explicit WorkerPool()
+    {
+        job_ = {};
+        next_.store(0);
+        busy_ = 0;
+        generation_ = 0;
+        workers_.clear();
+    }
+
+    ~WorkerPool() { Stop(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    auto operator=(const WorkerPool&) -> WorkerPool& = delete;
+
+    // worker_count threads are started next to the caller, 0 runs every loop on the caller.
+    auto Start(size_t worker_count) -> void
+    {
+        Stop();
+
+        // Workers of a restarted pool must not take the last job for a new one.
+        const uint64_t generation = generation_;
+
+        workers_.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; ++i)
+            workers_.emplace_back([this, generation](std::stop_token stop_token) { workerLoop(stop_token, generation); });
+    }
+
+    auto Stop() -> void
+    {
+        for (std::jthread& worker : workers_)
+            worker.request_stop();
+        workers_.clear();
+    }
+
+    [[nodiscard]] auto WorkerCount() const -> size_t { return workers_.size(); }
+
+    template <typename Fn>
+    auto For(size_t count, Fn&& fn) -> void
+    {
+        if (count <= 1 || workers_.empty()) {
+            for (size_t index = 0; index < count; ++index)
+                fn(index);
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            job_ = {
+                .context = &fn,
+                .invoke = [](void* context, size_t index) { (*static_cast<std::remove_reference_t<Fn>*>(context))(index); },
+                .count = count,
+            };
+            next_.store(0, std::memory_order_relaxed);
+            busy_ = workers_.size();
+            ++generation_;
+        }
+        work_cv_.notify_all();
+
+        run();
+
+        // Every worker has to be done with the job before fn goes out of scope.
+        std::unique_lock lock(mutex_);
+        done_cv_.wait(lock, [this] { return busy_ == 0; });
+    }
+
+    // One worker per hardware thread besides the caller, never more than a loop has indices to hand out.
+    [[nodiscard]] static auto WorkerCountFor(size_t max_count) -> size_t
+    {
+        const size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return std::min(hardware_threads, std::max<size_t>(max_count, 1)) - 1;
+    }
+private:
+    struct Job {
+        void* context;
+        void (*invoke)(void* context, size_t index);
+        size_t count;
+    };
+
+    auto run() -> void
+    {
+        for (size_t index = next_.fetch_add(1, std::memory_order_relaxed); index < job_.count; index = next_.fetch_add(1, std::memory_order_relaxed))
+            job_.invoke(job_.context, index);
+    }
+
+    auto workerLoop(std::stop_token stop_token, uint64_t generation) -> void
+    {
+        while (true) {
+            {
+                std::unique_lock lock(mutex_);
+                if (!work_cv_.wait(lock, stop_token, [this, generation] { return generation_ != generation; }))
+                    return;
+                generation = generation_;
+            }
+
+            run();
+
+            std::lock_guard lock(mutex_);
+            if (--busy_ == 0)
+                done_cv_.notify_one();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable_any work_cv_;
+    std::condition_variable done_cv_;
+    Job job_;                   // written under mutex_ before the workers are woken
+    std::atomic<size_t> next_;
+    size_t busy_;               // workers that haven't finished the current job
+    uint64_t generation_;
+    std::vector<std::jthread> workers_;     // last, so the threads are joined before the state above goes away
+};
@@ -0,0 +1,117 @@
+#include "DrmAdapterRegistry.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <stdio.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+auto AdapterRegistry::Create() -> std::unique_ptr<AdapterRegistry>
+{
+    return std::make_unique<DrmAdapterRegistry>();
+}
+
+static auto readSysfsFile(const char* path, char* buffer, size_t size) -> ssize_t
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    ssize_t length = read(fd, buffer, size - 1);
+    close(fd);
+
+    if (length < 0)
+        return -1;
+
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\0'))
+        --length;
+    buffer[length] = '\0';
+
+    return length;
+}
+
+static auto readSysfsNumber(const char* path) -> size_t
+{
+    char buffer[32] = {};
+    ssize_t length = readSysfsFile(path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return 0;
+
+    size_t value = 0;
+    std::from_chars(buffer, buffer + length, value);
+    return value;
+}
+
+DrmAdapterRegistry::DrmAdapterRegistry(std::string root)
+{
+    root_ = std::move(root);
+    adapters_.clear();
+    cards_.clear();
+}
+
+auto DrmAdapterRegistry::Refresh() -> bool
+{
+    std::vector<uint32_t> cards = {};
+
+    // Only the primary nodes (cardN) are adapters, connectors show up as cardN-<connector>.
+    char path[PATH_MAX] = {};
+    snprintf(path, sizeof(path), "%s/sys/class/drm", root_.c_str());
+
+    if (DIR* drm = opendir(path)) {
+        while (dirent* entry = readdir(drm)) {
+            const std::string_view name = entry->d_name;
+            if (!name.starts_with("card"))
+                continue;
+
+            uint32_t card = 0;
+            auto [ptr, ec] = std::from_chars(name.data() + 4, name.data() + name.size(), card);
+            if (ec == std::errc() && ptr == name.data() + name.size())
+                cards.push_back(card);
+        }
+        closedir(drm);
+    }
+
+    std::ranges::sort(cards);
+    if (cards == cards_)
+        return false;
+
+    cards_ = std::move(cards);
+    adapters_.clear();
+
+    char buffer[256] = {};
+
+    for (uint32_t card : cards_) {
+        AdapterInfo info = {};
+        info.adapter_index = card;
+
+        // amdgpu exposes VRAM and GTT (system memory the GPU can map), other drivers leave them at zero.
+        snprintf(path, sizeof(path), "%s/sys/class/drm/card%u/device/mem_info_vram_total", root_.c_str(), card);
+        info.dedicated_memory = readSysfsNumber(path);
+        snprintf(path, sizeof(path), "%s/sys/class/drm/card%u/device/mem_info_gtt_total", root_.c_str(), card);
+        info.shared_memory = readSysfsNumber(path);
+
+        // device links to the PCI device, its name is the slot that fdinfo reports as drm-pdev.
+        snprintf(path, sizeof(path), "%s/sys/class/drm/card%u/device", root_.c_str(), card);
+        ssize_t length = readlink(path, buffer, sizeof(buffer) - 1);
+        if (length > 0) {
+            const std::string_view target(buffer, static_cast<size_t>(length));
+            info.bus_id = target.substr(target.rfind('/') + 1);
+        }
+
+        snprintf(path, sizeof(path), "%s/sys/class/drm/card%u/device/driver", root_.c_str(), card);
+        length = readlink(path, buffer, sizeof(buffer) - 1);
+        if (length > 0) {
+            const std::string_view target(buffer, static_cast<size_t>(length));
+            info.name = target.substr(target.rfind('/') + 1);
+        }
+
+        adapters_.push_back(std::move(info));
+    }
+
+    return true;
+}
\ No newline at end of file
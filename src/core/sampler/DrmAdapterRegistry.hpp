@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <core/AdapterRegistry.hpp>
+
+class DrmAdapterRegistry : public AdapterRegistry {
+public:
+    // root is prepended to /sys, used to replay captured systems.
+    explicit DrmAdapterRegistry(std::string root = {});
+
+    auto Refresh() -> bool override;
+private:
+    // Sorted card numbers found under /sys/class/drm during the last refresh.
+    std::vector<uint32_t> cards_;
+    std::string root_;
+};
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "DrmFdinfo.hpp"
+
+#include <charconv>
+
+#include <core/ProcessInfo.hpp>
+
+enum DrmMemory_Kind : uint8_t {
+    DrmMemory_Resident = 0,
+    DrmMemory_Legacy = 1,   // drm-memory-<region>, only printed by older amdgpu
+    DrmMemory_Total = 2,
+    DrmMemory_Count = 3,
+};
+
+static auto parseUnsigned(std::string_view value, uint64_t& out) -> bool
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    if (ec != std::errc())
+        return false;
+
+    // Memory values may carry a KiB or MiB suffix, anything else (ie. "ns") is left as is.
+    std::string_view unit = value.substr(static_cast<size_t>(ptr - value.data()));
+    while (!unit.empty() && unit.front() == ' ')
+        unit.remove_prefix(1);
+
+    if (unit.starts_with("KiB"))
+        out *= 1024;
+    else if (unit.starts_with("MiB"))
+        out *= 1024 * 1024;
+
+    return true;
+}
+
+static auto findEngine(DrmFdinfo& out, std::string_view name) -> DrmEngineUsage*
+{
+    for (size_t i = 0; i < out.engine_count; ++i) {
+        if (out.engines[i].name == name)
+            return &out.engines[i];
+    }
+
+    if (out.engine_count >= DrmFdinfo_MaxEngines)
+        return nullptr;
+
+    DrmEngineUsage& engine = out.engines[out.engine_count++];
+    engine = {};
+    engine.name = name;
+    engine.capacity = 1;
+    return &engine;
+}
+
+auto ParseDrmFdinfo(std::string_view text, DrmFdinfo& out) -> bool
+{
+    out.driver = {};
+    out.pdev = {};
+    out.client_id = 0;
+    out.engine_count = 0;
+    out.vram_usage = 0;
+    out.gtt_usage = 0;
+
+    bool has_client_id = false;
+
+    // The same region is usually reported through several keys, prefer the resident size.
+    uint64_t vram[DrmMemory_Count] = {};
+    uint64_t gtt[DrmMemory_Count] = {};
+    bool has_memory[DrmMemory_Count] = {};
+
+    while (!text.empty()) {
+        const size_t line_end = text.find('\n');
+        std::string_view line = text.substr(0, line_end);
+        text = line_end == std::string_view::npos ? std::string_view{} : text.substr(line_end + 1);
+
+        if (!line.starts_with("drm-"))
+            continue;
+
+        const size_t separator = line.find(':');
+        if (separator == std::string_view::npos)
+            continue;
+
+        const std::string_view key = line.substr(4, separator - 4);
+        std::string_view value = line.substr(separator + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+
+        uint64_t number = 0;
+
+        if (key == "driver") {
+            out.driver = value;
+        }
+        else if (key == "pdev") {
+            out.pdev = value;
+        }
+        else if (key == "client-id") {
+            has_client_id = parseUnsigned(value, out.client_id);
+        }
+        else if (key.starts_with("engine-capacity-")) {
+            if (DrmEngineUsage* engine = findEngine(out, key.substr(16)); engine != nullptr && parseUnsigned(value, number) && number > 0)
+                engine->capacity = static_cast<uint32_t>(number);
+        }
+        else if (key.starts_with("engine-")) {
+            if (DrmEngineUsage* engine = findEngine(out, key.substr(7)); engine != nullptr && parseUnsigned(value, number))
+                engine->busy_ns = number;
+        }
+        else if (key.starts_with("total-cycles-")) {
+            if (DrmEngineUsage* engine = findEngine(out, key.substr(13)); engine != nullptr && parseUnsigned(value, number)) {
+                engine->total_cycles = number;
+                engine->has_cycles = true;
+            }
+        }
+        else if (key.starts_with("cycles-")) {
+            if (DrmEngineUsage* engine = findEngine(out, key.substr(7)); engine != nullptr && parseUnsigned(value, number)) {
+                engine->cycles = number;
+                engine->has_cycles = true;
+            }
+        }
+        else {
+            DrmMemory_Kind kind = DrmMemory_Count;
+            std::string_view region = {};
+
+            if (key.starts_with("resident-")) {
+                kind = DrmMemory_Resident;
+                region = key.substr(9);
+            }
+            else if (key.starts_with("memory-")) {
+                kind = DrmMemory_Legacy;
+                region = key.substr(7);
+            }
+            else if (key.starts_with("total-")) {
+                kind = DrmMemory_Total;
+                region = key.substr(6);
+            }
+
+            if (kind == DrmMemory_Count || !parseUnsigned(value, number))
+                continue;
+
+            // amdgpu: vram/gtt, i915: local0/system0, xe: vram0/gtt, the cpu and stolen regions are not GPU memory.
+            if (region.starts_with("vram") || region.starts_with("local")) {
+                vram[kind] += number;
+                has_memory[kind] = true;
+            }
+            else if (region.starts_with("gtt") || region.starts_with("system")) {
+                gtt[kind] += number;
+                has_memory[kind] = true;
+            }
+        }
+    }
+
+    for (int kind = 0; kind < DrmMemory_Count; ++kind) {
+        if (has_memory[kind]) {
+            out.vram_usage = static_cast<size_t>(vram[kind]);
+            out.gtt_usage = static_cast<size_t>(gtt[kind]);
+            break;
+        }
+    }
+
+    return has_client_id;
+}
+
+auto DecodeDrmEngineType(std::string_view name) -> uint32_t
+{
+    // amdgpu, i915, xe, msm, panfrost and v3d names.
+    if (name == "gfx" || name == "render" || name == "rcs" || name == "gpu" || name == "fragment" || name == "vertex-tiler" || name == "bin")
+        return GpuEngine_3D;
+    if (name == "compute" || name == "ccs" || name == "csd")
+        return GpuEngine_Compute;
+    if (name == "dma" || name == "sdma" || name == "copy" || name == "bcs" || name == "tfu")
+        return GpuEngine_Copy;
+    if (name.starts_with("enc"))
+        return GpuEngine_VideoEncode;
+    if (name == "dec" || name == "jpeg")
+        return GpuEngine_VideoDecode;
+
+    // Unified encode/decode engines.
+    if (name == "vcn" || name == "video" || name == "vcs")
+        return GpuEngine_VideoCodec;
+
+    return GpuEngine_Other;
+}
\ No newline at end of file
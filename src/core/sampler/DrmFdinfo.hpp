@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string_view>
+#include <stdint.h>
+
+constexpr size_t DrmFdinfo_MaxEngines = 16;
+
+struct DrmEngineUsage {
+    std::string_view name;
+    uint64_t busy_ns;       // drm-engine-<name>
+    uint64_t cycles;        // drm-cycles-<name>
+    uint64_t total_cycles;  // drm-total-cycles-<name>
+    uint32_t capacity;      // drm-engine-capacity-<name>, 1 if not reported
+    bool has_cycles;
+};
+
+// DRM client usage reported in /proc/<pid>/fdinfo/<fd>, see Documentation/gpu/drm-usage-stats.rst.
+// Views point into the parsed text.
+struct DrmFdinfo {
+    std::string_view driver;
+    std::string_view pdev;  // PCI slot, matches AdapterInfo::bus_id
+    uint64_t client_id;
+    DrmEngineUsage engines[DrmFdinfo_MaxEngines];
+    size_t engine_count;
+    size_t vram_usage;      // bytes, device local memory
+    size_t gtt_usage;       // bytes, system memory mapped by the GPU
+};
+
+// Returns false if text doesn't belong to a DRM client, ie. any other kind of fd.
+auto ParseDrmFdinfo(std::string_view text, DrmFdinfo& out) -> bool;
+
+// Maps driver specific engine names (gfx, render, rcs, enc, vcs, ...) to GpuEngine_Flags.
+auto DecodeDrmEngineType(std::string_view name) -> uint32_t;
\ No newline at end of file
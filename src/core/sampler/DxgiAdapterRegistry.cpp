@@ -0,0 +1,57 @@
+#include "DxgiAdapterRegistry.hpp"
+
+#pragma comment(lib, "dxgi.lib")
+
+auto AdapterRegistry::Create() -> std::unique_ptr<AdapterRegistry>
+{
+    return std::make_unique<DxgiAdapterRegistry>();
+}
+
+DxgiAdapterRegistry::DxgiAdapterRegistry()
+{
+    adapters_.clear();
+    dxgi_factory_ = nullptr;
+}
+
+DxgiAdapterRegistry::~DxgiAdapterRegistry()
+{
+    if (dxgi_factory_ != nullptr)
+        dxgi_factory_->Release();
+    dxgi_factory_ = nullptr;
+}
+
+auto DxgiAdapterRegistry::Refresh() -> bool
+{
+    if (dxgi_factory_ != nullptr && dxgi_factory_->IsCurrent())
+        return false;
+
+    if (dxgi_factory_ != nullptr)
+        dxgi_factory_->Release();
+    dxgi_factory_ = nullptr;
+
+    adapters_.clear();
+
+    if (FAILED(CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&dxgi_factory_)))
+        return true;
+
+    IDXGIAdapter1* adapter = nullptr;
+    for (UINT i = 0; dxgi_factory_->EnumAdapters1(i, &adapter) != DXGI_ERROR_NOT_FOUND; ++i) {
+        DXGI_ADAPTER_DESC1 desc = {};
+        if (SUCCEEDED(adapter->GetDesc1(&desc))) {
+            char name[128] = {};
+            WideCharToMultiByte(CP_UTF8, 0, desc.Description, -1, name, sizeof(name), nullptr, nullptr);
+
+            AdapterInfo info = {};
+            info.adapter_index = i;
+            info.luid.low = desc.AdapterLuid.LowPart;
+            info.luid.high = static_cast<uint32_t>(desc.AdapterLuid.HighPart);
+            info.name = name;
+            info.dedicated_memory = desc.DedicatedVideoMemory;
+            info.shared_memory = desc.SharedSystemMemory;
+            adapters_.push_back(std::move(info));
+        }
+        adapter->Release();
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#define NOMINMAX
+#include <Windows.h>
+#include <dxgi1_6.h>
+
+#include <core/AdapterRegistry.hpp>
+
+class DxgiAdapterRegistry : public AdapterRegistry {
+public:
+    explicit DxgiAdapterRegistry();
+    ~DxgiAdapterRegistry() override;
+
+    auto Refresh() -> bool override;
+private:
+    // IsCurrent() turns false once the adapters enumerated through the factory change.
+    IDXGIFactory1* dxgi_factory_;
+};
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "GpuInstanceName.hpp"
+
+#include <charconv>
+
+static auto nextToken(std::string_view& rest) -> std::string_view
+{
+    const size_t separator = rest.find('_');
+    std::string_view token = rest.substr(0, separator);
+    rest = separator == std::string_view::npos ? std::string_view{} : rest.substr(separator + 1);
+    return token;
+}
+
+static auto parseNumber(std::string_view token, uint32_t& value, int base = 10) -> bool
+{
+    if (base == 16 && token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X'))
+        token.remove_prefix(2);
+
+    // LUID parts are printed as 64-bit hex, only the low 32 bits are meaningful.
+    uint64_t parsed = 0;
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), parsed, base);
+    if (ec != std::errc() || ptr != token.data() + token.size())
+        return false;
+
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+auto ParseGpuInstanceName(std::string_view name, GpuInstanceName& out) -> bool
+{
+    out = {};
+
+    bool has_pid = false;
+    std::string_view rest = name;
+
+    while (!rest.empty()) {
+        const std::string_view token = nextToken(rest);
+
+        if (token == "pid") {
+            if (!parseNumber(nextToken(rest), out.pid))
+                return false;
+            has_pid = true;
+        }
+        else if (token == "luid") {
+            // HighPart comes first, same order as the LUID is printed everywhere else.
+            if (!parseNumber(nextToken(rest), out.luid_high, 16) || !parseNumber(nextToken(rest), out.luid_low, 16))
+                return false;
+        }
+        else if (token == "phys") {
+            if (!parseNumber(nextToken(rest), out.gpu_index))
+                return false;
+        }
+        else if (token == "eng") {
+            if (!parseNumber(nextToken(rest), out.engine_index))
+                return false;
+        }
+        else if (token == "engtype") {
+            out.engine_type = nextToken(rest);
+        }
+    }
+
+    return has_pid;
+}
+
+GpuInstanceCache::GpuInstanceCache()
+{
+    entries_.clear();
+    tick_ = 0;
+}
+
+auto GpuInstanceCache::Lookup(std::string_view name) -> const GpuInstanceKey*
+{
+    const size_t hash = std::hash<std::string_view>{}(name);
+
+    auto it = entries_.find(hash);
+    if (it != entries_.end() && it->second.name_length == name.size()) {
+        it->second.last_seen = tick_;
+        return &it->second.key;
+    }
+
+    GpuInstanceName parsed = {};
+    if (!ParseGpuInstanceName(name, parsed))
+        return nullptr;
+
+    Entry& entry = entries_[hash];
+    entry.key.pid = parsed.pid;
+    entry.key.luid_low = parsed.luid_low;
+    entry.key.luid_high = parsed.luid_high;
+    entry.key.gpu_index = parsed.gpu_index;
+    entry.key.engine_index = parsed.engine_index;
+    entry.key.engine_type = decodeGpuEngineType(parsed.engine_type);
+    entry.name_length = name.size();
+    entry.last_seen = tick_;
+
+    return &entry.key;
+}
+
+auto GpuInstanceCache::EndTick(uint32_t max_idle_ticks) -> void
+{
+    // Pruning walks the whole table, only do it once every max_idle_ticks.
+    if (++tick_ % max_idle_ticks != 0)
+        return;
+
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+        if (tick_ - it->second.last_seen > max_idle_ticks)
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <core/ProcessInfo.hpp>
+
+// Decoded form of a "GPU Engine" / "GPU Process Memory" counter instance name,
+// ie. pid_1234_luid_0x00000000_0x0000D1A2_phys_0_eng_3_engtype_VideoDecode,
+// where the LUID is printed as HighPart_LowPart.
+struct GpuInstanceKey {
+    uint32_t pid;
+    uint32_t luid_low;
+    uint32_t luid_high;
+    uint32_t gpu_index;
+    uint32_t engine_index;
+    uint32_t engine_type;       // GpuEngine_Flags, GpuEngine_None for "GPU Process Memory" instances
+};
+
+// Tokenizes the instance name in place without allocating, engine_type is a view into name.
+struct GpuInstanceName {
+    uint32_t pid;
+    uint32_t luid_low;
+    uint32_t luid_high;
+    uint32_t gpu_index;
+    uint32_t engine_index;
+    std::string_view engine_type;
+};
+
+auto ParseGpuInstanceName(std::string_view name, GpuInstanceName& out) -> bool;
+
+// Instance names are stable for the lifetime of a process, so they are only
+// parsed the first time they are seen and looked up by their hash afterwards.
+class GpuInstanceCache {
+public:
+    explicit GpuInstanceCache();
+
+    [[nodiscard]] auto Size() const -> size_t { return entries_.size(); }
+
+    // Returns nullptr if the name could not be parsed.
+    auto Lookup(std::string_view name) -> const GpuInstanceKey*;
+
+    // Drops names that were not looked up for at least max_idle_ticks calls to EndTick().
+    auto EndTick(uint32_t max_idle_ticks = 8) -> void;
+private:
+    struct Entry {
+        GpuInstanceKey key;
+        size_t name_length;
+        uint64_t last_seen;
+    };
+
+    std::unordered_map<size_t, Entry> entries_;
+    uint64_t tick_;
+};
\ No newline at end of file
@@ -0,0 +1,1070 @@
+#include "PdhProcessSampler.hpp"
+
+#include <Windows.h>
+#include <winternl.h>
+#include <d3dkmthk.h>
+#include <pdh.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <stdexcept>
+#include <PdhMsg.h>
+#include <algorithm>
+#include <vector>
+#include <thread>
+
+#include <config.hpp>
+
+#pragma comment(lib, "pdh.lib")
+#pragma comment(lib, "psapi.lib")
+#pragma comment(lib, "gdi32.lib")
+
+static auto monotonicNs() -> uint64_t
+{
+    LARGE_INTEGER counter = {}, frequency = {};
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    // Split so the multiplication doesn't overflow after a few days of uptime.
+    const uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    const uint64_t per_second = static_cast<uint64_t>(frequency.QuadPart);
+    return ticks / per_second * 1'000'000'000ull + ticks % per_second * 1'000'000'000ull / per_second;
+}
+
+auto ProcessSampler::Create() -> std::unique_ptr<ProcessSampler>
+{
+    return std::make_unique<PdhProcessSampler>();
+}
+
+PdhProcessSampler::PdhProcessSampler()
+{
+    process_map_.clear();
+    decode_tasks_.clear();
+    active_tasks_.clear();
+
+    pdh_query_ = { };
+    pdh_gpu_query_ = { };
+
+    pdh_processes_id_counter_ = { };
+    pdh_parent_process_id_counter_ = { };
+    pdh_dedicated_vram_counter_ = { };
+    pdh_shared_vram_counter_ = { };
+    pdh_gpu_utilization_counter_ = { };
+    pdh_user_process_time_ = { };
+    pdh_kernel_process_time_ = { };
+    pdh_total_process_time_ = { };
+    pdh_process_memory_ = { };
+    pdh_process_page_faults_ = { };
+    pdh_io_query_ = nullptr;
+    pdh_process_read_bytes_ = nullptr;
+    pdh_process_write_bytes_ = nullptr;
+    pdh_process_read_operations_ = nullptr;
+    pdh_process_write_operations_ = nullptr;
+    pdh_core_query_ = nullptr;
+    pdh_core_processor_time_ = nullptr;
+    pdh_core_idle_time_ = nullptr;
+    pdh_core_frequency_ = nullptr;
+    pdh_core_performance_ = nullptr;
+    pdh_disk_query_ = nullptr;
+    pdh_disk_read_bytes_ = nullptr;
+    pdh_disk_write_bytes_ = nullptr;
+    pdh_disk_idle_time_ = nullptr;
+    pdh_disk_queue_length_ = nullptr;
+    pdh_disk_transfer_time_ = nullptr;
+    pdh_thermal_query_ = nullptr;
+    pdh_thermal_temperature_ = nullptr;
+    pdh_thermal_passive_limit_ = nullptr;
+    pdh_thermal_throttle_reasons_ = nullptr;
+    thermal_adapter_ = 0;
+    base_clock_mhz_ = 0;
+    system_info_ = { };
+    system_memory_ = { };
+    adapters_ = nullptr;
+
+    focus_process_ = nullptr;
+    focus_pid_ = 0;
+    focus_cpu_time_ = {};
+    focus_page_faults_ = {};
+
+    focus_threads_.clear();
+    focus_thread_rows_.clear();
+    focus_busiest_threads_.clear();
+    focus_threads_pid_ = 0;
+    focus_threads_sample_ns_ = 0;
+}
+
+auto PdhProcessSampler::Initialize() -> bool
+{
+    PDH_STATUS result = {};
+
+    try {
+        result = PdhOpenQueryA(NULL, 0, &pdh_query_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to open query through PdhOpenQueryA");
+
+        // GPU counters live in their own query so they are only collected when something consumes them.
+        result = PdhOpenQueryA(NULL, 0, &pdh_gpu_query_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to open query through PdhOpenQueryA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Id Process", 0, &pdh_processes_id_counter_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Id Process) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Creating Process ID", 0, &pdh_parent_process_id_counter_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Creating Process ID) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_gpu_query_, "\\GPU Process Memory(*)\\Dedicated Usage", 0, &pdh_dedicated_vram_counter_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Dedicated Usage) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_gpu_query_, "\\GPU Process Memory(*)\\Shared Usage", 0, &pdh_shared_vram_counter_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Shared Usage) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_gpu_query_, "\\GPU Engine(*)\\Utilization Percentage", 0, &pdh_gpu_utilization_counter_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Utilization Percentage) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% User Time", 0, &pdh_user_process_time_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (User Time) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% Privileged Time", 0, &pdh_kernel_process_time_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Privileged Time) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\% Processor Time", 0, &pdh_total_process_time_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Processor Time) through PdhAddCounterA");
+
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Working Set", 0, &pdh_process_memory_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Processor Time) through PdhAddCounterA");
+
+        // Soft and hard faults together, PDH has no per-process split.
+        result = PdhAddEnglishCounterA(pdh_query_, "\\Process(*)\\Page Faults/sec", 0, &pdh_process_page_faults_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to register counter (Page Faults/sec) through PdhAddCounterA");
+    }
+    catch (std::exception& ex) {
+#ifdef _WIN32
+        char error_message[512] = {};
+        snprintf(error_message, 512, "Failed to initialize PDH, this means you will not be able to get performnce statistics, other systems continue to operate.\n\n%s\r\n", ex.what());
+        MessageBoxA(NULL, error_message, APP_NAME, MB_OK);
+#endif
+        printf("%s\n\n", ex.what());
+        return false;
+    }
+
+    addDecodeTask(pdh_dedicated_vram_counter_, MetricGroup_Gpu, GpuMetric_Dedicated_Vram, "Dedicated Usage");
+    addDecodeTask(pdh_shared_vram_counter_, MetricGroup_Gpu, GpuMetric_Shared_Vram, "Shared Usage");
+    addDecodeTask(pdh_gpu_utilization_counter_, MetricGroup_Gpu, GpuMetric_Engine_Utilization, "Utilization Percentage");
+    addDecodeTask(pdh_user_process_time_, MetricGroup_Cpu, CpuMetric_User_Time, "User Time");
+    addDecodeTask(pdh_kernel_process_time_, MetricGroup_Cpu, CpuMetric_Priviledged_Time, "Privileged Time");
+    addDecodeTask(pdh_total_process_time_, MetricGroup_Cpu, CpuMetric_Total_Time, "Processor Time");
+    addDecodeTask(pdh_process_memory_, MetricGroup_Memory, MemoryMetric_Working_Set, "Working Set");
+    addDecodeTask(pdh_process_page_faults_, MetricGroup_Memory, MemoryMetric_Page_Faults, "Page Faults/sec");
+
+    // Per-core counters are optional, SampleSystem() reports no cores without them.
+    if (PdhOpenQueryA(NULL, 0, &pdh_core_query_) == ERROR_SUCCESS) {
+        if (PdhAddEnglishCounterA(pdh_core_query_, "\\Processor Information(*)\\% Processor Time", 0, &pdh_core_processor_time_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_core_query_, "\\Processor Information(*)\\% Idle Time", 0, &pdh_core_idle_time_) != ERROR_SUCCESS) {
+            PdhCloseQuery(pdh_core_query_);
+            pdh_core_query_ = nullptr;
+        }
+        else {
+            // Processor Frequency is the nominal clock, % Processor Performance scales it to the current one (above 100 while boosting).
+            if (PdhAddEnglishCounterA(pdh_core_query_, "\\Processor Information(*)\\Processor Frequency", 0, &pdh_core_frequency_) != ERROR_SUCCESS)
+                pdh_core_frequency_ = nullptr;
+            if (PdhAddEnglishCounterA(pdh_core_query_, "\\Processor Information(*)\\% Processor Performance", 0, &pdh_core_performance_) != ERROR_SUCCESS)
+                pdh_core_performance_ = nullptr;
+        }
+    }
+    else {
+        pdh_core_query_ = nullptr;
+    }
+
+    // Process I/O counts file, network and device I/O together, there is no storage-only counter per process.
+    if (PdhOpenQueryA(NULL, 0, &pdh_io_query_) == ERROR_SUCCESS) {
+        if (PdhAddEnglishCounterA(pdh_io_query_, "\\Process(*)\\IO Read Bytes/sec", 0, &pdh_process_read_bytes_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_io_query_, "\\Process(*)\\IO Write Bytes/sec", 0, &pdh_process_write_bytes_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_io_query_, "\\Process(*)\\IO Read Operations/sec", 0, &pdh_process_read_operations_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_io_query_, "\\Process(*)\\IO Write Operations/sec", 0, &pdh_process_write_operations_) != ERROR_SUCCESS) {
+            PdhCloseQuery(pdh_io_query_);
+            pdh_io_query_ = nullptr;
+        }
+        else {
+            addDecodeTask(pdh_process_read_bytes_, MetricGroup_Disk, IoMetric_Read_Bytes, nullptr);
+            addDecodeTask(pdh_process_write_bytes_, MetricGroup_Disk, IoMetric_Write_Bytes, nullptr);
+            addDecodeTask(pdh_process_read_operations_, MetricGroup_Disk, IoMetric_Read_Operations, nullptr);
+            addDecodeTask(pdh_process_write_operations_, MetricGroup_Disk, IoMetric_Write_Operations, nullptr);
+        }
+    }
+    else {
+        pdh_io_query_ = nullptr;
+    }
+
+    // A task is the smallest unit handed to a worker, more workers than tasks would only sleep.
+    decode_workers_.Start(WorkerPool::WorkerCountFor(decode_tasks_.size()));
+
+    if (PdhOpenQueryA(NULL, 0, &pdh_disk_query_) == ERROR_SUCCESS) {
+        if (PdhAddEnglishCounterA(pdh_disk_query_, "\\PhysicalDisk(*)\\Disk Read Bytes/sec", 0, &pdh_disk_read_bytes_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_disk_query_, "\\PhysicalDisk(*)\\Disk Write Bytes/sec", 0, &pdh_disk_write_bytes_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_disk_query_, "\\PhysicalDisk(*)\\% Idle Time", 0, &pdh_disk_idle_time_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_disk_query_, "\\PhysicalDisk(*)\\Avg. Disk Queue Length", 0, &pdh_disk_queue_length_) != ERROR_SUCCESS ||
+            PdhAddEnglishCounterA(pdh_disk_query_, "\\PhysicalDisk(*)\\Avg. Disk sec/Transfer", 0, &pdh_disk_transfer_time_) != ERROR_SUCCESS) {
+            PdhCloseQuery(pdh_disk_query_);
+            pdh_disk_query_ = nullptr;
+        }
+    }
+    else {
+        pdh_disk_query_ = nullptr;
+    }
+
+    // A passive limit below 100% means the zone is slowing the processors down to cool off.
+    if (PdhOpenQueryA(NULL, 0, &pdh_thermal_query_) == ERROR_SUCCESS) {
+        if (PdhAddEnglishCounterA(pdh_thermal_query_, "\\Thermal Zone Information(*)\\Temperature", 0, &pdh_thermal_temperature_) != ERROR_SUCCESS) {
+            PdhCloseQuery(pdh_thermal_query_);
+            pdh_thermal_query_ = nullptr;
+        }
+        else {
+            if (PdhAddEnglishCounterA(pdh_thermal_query_, "\\Thermal Zone Information(*)\\% Passive Limit", 0, &pdh_thermal_passive_limit_) != ERROR_SUCCESS)
+                pdh_thermal_passive_limit_ = nullptr;
+            if (PdhAddEnglishCounterA(pdh_thermal_query_, "\\Thermal Zone Information(*)\\Throttle Reasons", 0, &pdh_thermal_throttle_reasons_) != ERROR_SUCCESS)
+                pdh_thermal_throttle_reasons_ = nullptr;
+        }
+    }
+    else {
+        pdh_thermal_query_ = nullptr;
+    }
+
+    DWORD base_clock = 0;
+    DWORD base_clock_size = sizeof(base_clock);
+    if (RegGetValueA(HKEY_LOCAL_MACHINE, "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0", "~MHz", RRF_RT_REG_DWORD, nullptr, &base_clock, &base_clock_size) == ERROR_SUCCESS)
+        base_clock_mhz_ = base_clock;
+
+    GetSystemInfo(&system_info_);
+    system_memory_.dwLength = sizeof(system_memory_);
+    GlobalMemoryStatusEx(&system_memory_);
+
+    adapters_ = AdapterRegistry::Create();
+    adapters_->Refresh();
+
+    // Task Manager reads the GPU temperature through the same adapter performance data (WDDM 2.4+).
+    const AdapterInfo* discrete = nullptr;
+    for (const AdapterInfo& adapter : adapters_->Adapters()) {
+        if (discrete == nullptr || adapter.dedicated_memory > discrete->dedicated_memory)
+            discrete = &adapter;
+    }
+
+    if (discrete != nullptr) {
+        D3DKMT_OPENADAPTERFROMLUID open_adapter = {};
+        open_adapter.AdapterLuid.LowPart = discrete->luid.low;
+        open_adapter.AdapterLuid.HighPart = static_cast<LONG>(discrete->luid.high);
+        if (D3DKMTOpenAdapterFromLuid(&open_adapter) >= 0)
+            thermal_adapter_ = open_adapter.hAdapter;
+    }
+
+    return true;
+}
+
+auto PdhProcessSampler::Destroy() -> void
+{
+    decode_workers_.Stop();
+
+    PdhCloseQuery(pdh_query_);
+    PdhCloseQuery(pdh_gpu_query_);
+
+    PdhRemoveCounter(pdh_processes_id_counter_);
+    PdhRemoveCounter(pdh_parent_process_id_counter_);
+    PdhRemoveCounter(pdh_dedicated_vram_counter_);
+    PdhRemoveCounter(pdh_shared_vram_counter_);
+    PdhRemoveCounter(pdh_gpu_utilization_counter_);
+    PdhRemoveCounter(pdh_user_process_time_);
+    PdhRemoveCounter(pdh_kernel_process_time_);
+    PdhRemoveCounter(pdh_total_process_time_);
+    PdhRemoveCounter(pdh_process_memory_);
+    PdhRemoveCounter(pdh_process_page_faults_);
+    decode_tasks_.clear();
+    active_tasks_.clear();
+
+    if (pdh_core_query_ != nullptr)
+        PdhCloseQuery(pdh_core_query_);
+    pdh_core_query_ = nullptr;
+    pdh_core_processor_time_ = nullptr;
+    pdh_core_idle_time_ = nullptr;
+    pdh_core_frequency_ = nullptr;
+    pdh_core_performance_ = nullptr;
+
+    if (pdh_io_query_ != nullptr)
+        PdhCloseQuery(pdh_io_query_);
+    pdh_io_query_ = nullptr;
+
+    if (pdh_disk_query_ != nullptr)
+        PdhCloseQuery(pdh_disk_query_);
+    pdh_disk_query_ = nullptr;
+
+    if (pdh_thermal_query_ != nullptr)
+        PdhCloseQuery(pdh_thermal_query_);
+    pdh_thermal_query_ = nullptr;
+
+    if (thermal_adapter_ != 0) {
+        D3DKMT_CLOSEADAPTER close_adapter = {};
+        close_adapter.hAdapter = thermal_adapter_;
+        D3DKMTCloseAdapter(&close_adapter);
+    }
+    thermal_adapter_ = 0;
+
+    system_info_ = { };
+    system_memory_ = { };
+    adapters_.reset();
+
+    if (focus_process_ != nullptr)
+        CloseHandle(focus_process_);
+    focus_process_ = nullptr;
+    focus_pid_ = 0;
+
+    for (auto& [tid, thread] : focus_threads_)
+        CloseHandle(thread.handle);
+    focus_threads_.clear();
+    focus_threads_pid_ = 0;
+}
+
+auto PdhProcessSampler::Sample(ProcessTable& table, uint32_t metric_groups) -> void
+{
+    PDH_STATUS result = {};
+
+    // Runs on the sampling thread, a dialog here would stall it and Destroy() joining it. The caller logs
+    // the failure and keeps publishing the previous snapshot until a collection succeeds again.
+    result = PdhCollectQueryData(pdh_query_);
+    if (result != ERROR_SUCCESS)
+        throw std::runtime_error("Failed to collect query data through PdhCollectQueryData");
+
+    if (metric_groups & MetricGroup_Gpu) {
+        result = PdhCollectQueryData(pdh_gpu_query_);
+        if (result != ERROR_SUCCESS)
+            throw std::runtime_error("Failed to collect GPU query data through PdhCollectQueryData");
+    }
+
+    // Every row has to exist before the workers below look processes up, only these two touch the table itself.
+    mapProcessesToPid(table, pdh_processes_id_counter_);
+    mapParentProcesses(table, pdh_parent_process_id_counter_);
+
+    // Rate counters need two collections, processes report no I/O on the first tick.
+    uint32_t decode_groups = metric_groups & (MetricGroup_Gpu | MetricGroup_Cpu | MetricGroup_Memory);
+    if ((metric_groups & MetricGroup_Disk) && pdh_io_query_ != nullptr && PdhCollectQueryData(pdh_io_query_) == ERROR_SUCCESS)
+        decode_groups |= MetricGroup_Disk;
+
+    active_tasks_.clear();
+    for (CounterDecodeTask& task : decode_tasks_) {
+        if (task.metric_group & decode_groups)
+            active_tasks_.push_back(&task);
+    }
+
+    // With thousands of GPU engine instances decoding the arrays one after another dominates
+    // the tick. They are independent of each other until they are applied, so each gets a worker.
+    decode_workers_.For(active_tasks_.size(), [&](size_t index) {
+        decodeCounter(table, *active_tasks_[index]);
+    });
+
+    // Applied in registration order, the GPU maps are filled the same way whichever worker finished first.
+    for (CounterDecodeTask* task : active_tasks_) {
+        if (task->failed && task->name != nullptr)
+            throw std::runtime_error(std::string("Failed to get formatted counter array size (") + task->name + ") through PdhGetFormattedCounterArrayA");
+
+        applyCounter(*task);
+
+        if (task->metric_group == MetricGroup_Gpu)
+            task->instances.EndTick();
+    }
+
+    if (metric_groups & MetricGroup_Gpu)
+        adapters_->Refresh();
+
+    for (auto& process : table.Rows()) {
+        for (auto& [index, info] : process.gpus) {
+            if (const AdapterInfo* adapter = adapters_->FindByLuid(info.luid.low, info.luid.high)) {
+                info.adapter_index = adapter->adapter_index;
+                info.memory.dedicated_available = adapter->dedicated_memory;
+                info.memory.shared_available = adapter->shared_memory;
+            }
+        }
+
+        process.cpu.user_cpu_usage /= system_info_.dwNumberOfProcessors;
+        process.cpu.kernel_cpu_usage /= system_info_.dwNumberOfProcessors;
+        process.cpu.total_cpu_usage /= system_info_.dwNumberOfProcessors;
+        process.memory_available = system_memory_.ullTotalPhys;
+    }
+}
+
+auto PdhProcessSampler::SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool
+{
+    auto toUInt64 = [](const FILETIME& time) -> uint64_t {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    if (pid != focus_pid_) {
+        if (focus_process_ != nullptr)
+            CloseHandle(focus_process_);
+
+        focus_process_ = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        focus_pid_ = focus_process_ != nullptr ? pid : 0;
+        focus_cpu_time_.Reset();
+        focus_page_faults_.Reset();
+
+        if (focus_process_ == nullptr)
+            return false;
+    }
+
+    // The handle keeps the process object alive, so an exited process never hands its pid to a new one here.
+    DWORD exit_code = 0;
+    FILETIME creation_time = {}, exit_time = {}, kernel_time = {}, user_time = {};
+    if (!GetExitCodeProcess(focus_process_, &exit_code) || exit_code != STILL_ACTIVE ||
+        !GetProcessTimes(focus_process_, &creation_time, &exit_time, &kernel_time, &user_time)) {
+        CloseHandle(focus_process_);
+        focus_process_ = nullptr;
+        focus_pid_ = 0;
+        return false;
+    }
+
+    // The creation time tells a new process apart from the previous focus, even if the pid is the same.
+    const uint64_t instance = toUInt64(creation_time);
+
+    info.pid = pid;
+
+    // CPU times are in 100ns units, 100'000 of them per second are 1% of a core.
+    if (focus_cpu_time_.Update(instance, monotonicNs(), { toUInt64(user_time), toUInt64(kernel_time) }) && (metric_groups & MetricGroup_Cpu)) {
+        const double scale = 1.0 / (100'000.0 * system_info_.dwNumberOfProcessors);
+
+        info.cpu.user_cpu_usage = focus_cpu_time_.Rate(0) * scale;
+        info.cpu.kernel_cpu_usage = focus_cpu_time_.Rate(1) * scale;
+        info.cpu.total_cpu_usage = info.cpu.user_cpu_usage + info.cpu.kernel_cpu_usage;
+    }
+
+    if (metric_groups & MetricGroup_Memory) {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (GetProcessMemoryInfo(focus_process_, &counters, sizeof(counters))) {
+            info.memory_usage = counters.WorkingSetSize;
+
+            if (focus_page_faults_.Update(instance, monotonicNs(), { counters.PageFaultCount }))
+                info.faults.minor_per_second = focus_page_faults_.Rate(0);
+        }
+    }
+
+    info.memory_available = system_memory_.ullTotalPhys;
+
+    return true;
+}
+
+auto PdhProcessSampler::SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool
+{
+    auto toUInt64 = [](const FILETIME& time) -> uint64_t {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    if (pid != focus_threads_pid_) {
+        for (auto& [tid, thread] : focus_threads_)
+            CloseHandle(thread.handle);
+
+        focus_threads_.clear();
+        focus_busiest_threads_.clear();
+        focus_threads_pid_ = pid;
+        focus_threads_sample_ns_ = 0;
+    }
+
+    const uint64_t now = monotonicNs();
+
+    // Thread times only advance with the scheduler tick (15.6ms by default), so
+    // they are averaged over a quarter second and repeated on the focus ticks in between.
+    if (focus_threads_sample_ns_ > 0 && now - focus_threads_sample_ns_ < 250'000'000ull) {
+        threads = focus_busiest_threads_;
+        return true;
+    }
+
+    focus_threads_sample_ns_ = now;
+
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE)
+        return false;
+
+    for (auto& [tid, thread] : focus_threads_)
+        thread.sampled = false;
+
+    focus_thread_rows_.clear();
+
+    THREADENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+
+    for (BOOL found = Thread32First(snapshot, &entry); found; found = Thread32Next(snapshot, &entry)) {
+        if (entry.th32OwnerProcessID != pid)
+            continue;
+
+        auto [it, inserted] = focus_threads_.try_emplace(entry.th32ThreadID);
+        FocusThread& thread = it->second;
+
+        if (inserted) {
+            thread.handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID);
+            if (thread.handle == nullptr) {
+                focus_threads_.erase(it);
+                continue;
+            }
+        }
+
+        FILETIME creation_time = {}, exit_time = {}, kernel_time = {}, user_time = {};
+        if (!GetThreadTimes(thread.handle, &creation_time, &exit_time, &kernel_time, &user_time))
+            continue;
+
+        // 100ns units per second, 100'000 of them are 1% of a core.
+        const bool has_baseline = thread.cpu_time.Update(toUInt64(creation_time), monotonicNs(), { toUInt64(user_time) + toUInt64(kernel_time) });
+
+        // Threads are named at any time through SetThreadDescription.
+        PWSTR description = nullptr;
+        if (SUCCEEDED(GetThreadDescription(thread.handle, &description)) && description != nullptr) {
+            char name[64] = {};
+            WideCharToMultiByte(CP_UTF8, 0, description, -1, name, sizeof(name) - 1, nullptr, nullptr);
+            thread.name = name;
+            LocalFree(description);
+        }
+        if (thread.name.empty())
+            thread.name = std::to_string(entry.th32ThreadID);
+
+        ThreadInfo& row = focus_thread_rows_.emplace_back();
+        row.tid = entry.th32ThreadID;
+        row.name = thread.name;
+        row.cpu_usage = has_baseline ? thread.cpu_time.Rate(0) / 100'000.0 : 0.0;
+
+        thread.sampled = true;
+    }
+
+    CloseHandle(snapshot);
+
+    for (auto it = focus_threads_.begin(); it != focus_threads_.end(); ) {
+        if (!it->second.sampled) {
+            CloseHandle(it->second.handle);
+            it = focus_threads_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Thread states and context switches are only exposed through NtQuerySystemInformation and run-queue delay
+    // only through ETW, state_fractions and the scheduler values stay zeroed.
+    scheduler = {};
+
+    const size_t busiest = std::min(count, focus_thread_rows_.size());
+    std::partial_sort(focus_thread_rows_.begin(), focus_thread_rows_.begin() + busiest, focus_thread_rows_.end(),
+        [](const ThreadInfo& a, const ThreadInfo& b) { return a.cpu_usage > b.cpu_usage; });
+
+    focus_busiest_threads_.assign(focus_thread_rows_.begin(), focus_thread_rows_.begin() + busiest);
+    threads = focus_busiest_threads_;
+
+    return true;
+}
+
+auto PdhProcessSampler::SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void
+{
+    // Keeps the capacity of cores and disks, everything else is refilled below.
+    std::vector<CpuCoreInfo> cores = std::move(system.cores);
+    std::vector<DiskInfo> disks = std::move(system.disks);
+    cores.clear();
+    disks.clear();
+    system = {};
+    system.cores = std::move(cores);
+    system.disks = std::move(disks);
+
+    // Windows has no pressure stall information, swap is the part of the commit charge that doesn't fit into RAM.
+    if (metric_groups & MetricGroup_Memory) {
+        MEMORYSTATUSEX memory = {};
+        memory.dwLength = sizeof(memory);
+        if (GlobalMemoryStatusEx(&memory)) {
+            const uint64_t committed = memory.ullTotalPageFile - memory.ullAvailPageFile;
+            const uint64_t resident = memory.ullTotalPhys - memory.ullAvailPhys;
+            system.swap_total = static_cast<size_t>(memory.ullTotalPageFile - std::min(memory.ullTotalPageFile, memory.ullTotalPhys));
+            system.swap_usage = static_cast<size_t>(committed - std::min(committed, resident));
+        }
+    }
+
+    if ((metric_groups & MetricGroup_Disk) && pdh_disk_query_ != nullptr && PdhCollectQueryData(pdh_disk_query_) == ERROR_SUCCESS) {
+        calculateDiskMetricFromCounter(system, pdh_disk_read_bytes_, DiskMetric_Read_Bytes);
+        calculateDiskMetricFromCounter(system, pdh_disk_write_bytes_, DiskMetric_Write_Bytes);
+        calculateDiskMetricFromCounter(system, pdh_disk_idle_time_, DiskMetric_Idle_Time);
+        calculateDiskMetricFromCounter(system, pdh_disk_queue_length_, DiskMetric_Queue_Length);
+        calculateDiskMetricFromCounter(system, pdh_disk_transfer_time_, DiskMetric_Transfer_Time);
+
+        for (uint32_t i = 0; i < system.disks.size(); ++i) {
+            if (system.disks[i].utilization_percentage > system.disks[system.busiest_disk].utilization_percentage)
+                system.busiest_disk = i;
+        }
+    }
+
+    // Thermal zones are not guaranteed to sit on the CPU, the hottest one stands in for it.
+    if (metric_groups & MetricGroup_Thermal) {
+        if (pdh_thermal_query_ != nullptr && PdhCollectQueryData(pdh_thermal_query_) == ERROR_SUCCESS) {
+            calculateThermalMetricFromCounter(system, pdh_thermal_temperature_, ThermalMetric_Temperature);
+            calculateThermalMetricFromCounter(system, pdh_thermal_passive_limit_, ThermalMetric_Passive_Limit);
+            calculateThermalMetricFromCounter(system, pdh_thermal_throttle_reasons_, ThermalMetric_Throttle_Reasons);
+        }
+
+        readAdapterThermal(system);
+        system.thermal.cpu_max_clock_mhz = base_clock_mhz_;
+    }
+
+    if (!(metric_groups & MetricGroup_Cores) || pdh_core_query_ == nullptr)
+        return;
+
+    // Rate counters need two collections, the first call after Initialize() reports no cores.
+    if (PdhCollectQueryData(pdh_core_query_) != ERROR_SUCCESS)
+        return;
+
+    // The frequency is filled in before the performance counter scales it.
+    calculateCoreMetricFromCounter(system, pdh_core_processor_time_, CoreMetric_Processor_Time);
+    calculateCoreMetricFromCounter(system, pdh_core_idle_time_, CoreMetric_Idle_Time);
+    calculateCoreMetricFromCounter(system, pdh_core_frequency_, CoreMetric_Frequency);
+    calculateCoreMetricFromCounter(system, pdh_core_performance_, CoreMetric_Performance);
+    std::ranges::sort(system.cores, {}, &CpuCoreInfo::core_index);
+
+    for (const CpuCoreInfo& core : system.cores) {
+        if (core.busy_percentage > system.max_core_usage) {
+            system.max_core_usage = core.busy_percentage;
+            system.max_core_index = core.core_index;
+        }
+        system.thermal.cpu_clock_mhz = std::max(system.thermal.cpu_clock_mhz, core.frequency_mhz);
+    }
+}
+
+auto PdhProcessSampler::SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool
+{
+    detail = {};
+    detail.pid = pid;
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (process == nullptr)
+        return false;
+
+    // PrivateWorkingSetSize needs the Windows 10 1809 counters, older systems fail the call.
+    PROCESS_MEMORY_COUNTERS_EX2 counters = {};
+    const BOOL result = GetProcessMemoryInfo(process, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+    CloseHandle(process);
+
+    if (!result)
+        return false;
+
+    detail.resident = counters.WorkingSetSize;
+    detail.uss = counters.PrivateWorkingSetSize;
+
+    return true;
+}
+
+auto PdhProcessSampler::TakeExits(std::vector<ProcessExit>& exits) -> void
+{
+    exits.clear();
+}
+
+auto PdhProcessSampler::mapProcessesToPid(ProcessTable& table, PDH_HCOUNTER counter) -> void
+{
+    PDH_STATUS result = {};
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA)
+        throw std::runtime_error("Failed to get formatted counter array size (Dedicated Usage) through PdhGetFormattedCounterArrayA");
+
+    std::vector<std::byte> buffer(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, items);
+
+    // Names of exited processes are dropped once they make up half of the map.
+    if (process_map_.size() > 2 * static_cast<size_t>(itemCount))
+        process_map_.clear();
+
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (items != nullptr && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
+            const std::string_view name = items[i].szName;
+
+            // Task Manager doesn't list these either.
+            if (name.empty() || name.find("Idle") != std::string_view::npos || name.find("_Total") != std::string_view::npos)
+                continue;
+
+            uint32_t pid = static_cast<uint32_t>(items[i].FmtValue.largeValue);
+
+            // PDH doesn't expose the process start time, the image name tells reused pids apart instead.
+            // The "#N" suffix is left out as it shifts whenever a process with the same image exits.
+            const std::string_view image = name.substr(0, name.find('#'));
+            ProcessInfo& process = table.Upsert(pid, std::hash<std::string_view>{}(image));
+            if (table.String(process.name_id) != name)
+                process.name_id = table.Intern(name);
+
+            if (auto it = process_map_.find(name); it != process_map_.end())
+                it->second = pid;
+            else
+                process_map_.emplace(name, pid);
+        }
+    }
+}
+
+auto PdhProcessSampler::mapParentProcesses(ProcessTable& table, PDH_HCOUNTER counter) -> void
+{
+    PDH_STATUS result = {};
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA)
+        throw std::runtime_error("Failed to get formatted counter array size (Creating Process ID) through PdhGetFormattedCounterArrayA");
+
+    std::vector<std::byte> buffer(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_LARGE, &bufferSize, &itemCount, items);
+
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (items != nullptr && items[i].FmtValue.CStatus == ERROR_SUCCESS) {
+            ProcessInfo* process = findProcessByInstance(table, items[i].szName);
+            if (process != nullptr)
+                process->parent_pid = static_cast<uint32_t>(items[i].FmtValue.largeValue);
+        }
+    }
+}
+
+auto PdhProcessSampler::findProcessByInstance(ProcessTable& table, const char* instance) -> ProcessInfo*
+{
+    auto it = process_map_.find(std::string_view(instance));
+    return it != process_map_.end() ? table.Find(it->second) : nullptr;
+}
+
+auto PdhProcessSampler::addDecodeTask(PDH_HCOUNTER counter, uint32_t metric_group, uint8_t metric, const char* name) -> void
+{
+    CounterDecodeTask& task = decode_tasks_.emplace_back();
+    task.counter = counter;
+    task.metric_group = metric_group;
+    task.metric = metric;
+    task.name = name;
+    task.failed = false;
+}
+
+auto PdhProcessSampler::decodeCounter(ProcessTable& table, CounterDecodeTask& task) -> void
+{
+    PDH_STATUS result = {};
+
+    task.values.clear();
+    task.failed = false;
+
+    // GPU memory and engine utilization are read as integers like Task Manager shows them.
+    const DWORD format = task.metric_group == MetricGroup_Gpu ? PDH_FMT_LARGE : PDH_FMT_DOUBLE | PDH_FMT_NOCAP100;
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(task.counter, format, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA) {
+        task.failed = true;
+        return;
+    }
+
+    // The buffer is kept between ticks, the array only grows when processes are started.
+    task.buffer.resize(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(task.buffer.data());
+    result = PdhGetFormattedCounterArrayA(task.counter, format, &bufferSize, &itemCount, items);
+    if (result != ERROR_SUCCESS)
+        return;
+
+    // Only reads the table and the instance map, both are left alone until every worker is done.
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (items[i].FmtValue.CStatus != ERROR_SUCCESS)
+            continue;
+
+        DecodedCounterValue decoded = {};
+        if (task.metric_group == MetricGroup_Gpu) {
+            const GpuInstanceKey* key = task.instances.Lookup(items[i].szName);
+            if (key == nullptr)
+                continue;
+
+            // Instances without a listed process belong to system processes, they are skipped like Task Manager does.
+            decoded.process = table.Find(key->pid);
+            decoded.gpu = *key;
+            decoded.value = static_cast<double>(items[i].FmtValue.largeValue);
+        }
+        else {
+            decoded.process = findProcessByInstance(table, items[i].szName);
+            decoded.value = items[i].FmtValue.doubleValue;
+        }
+
+        if (decoded.process != nullptr)
+            task.values.push_back(decoded);
+    }
+}
+
+auto PdhProcessSampler::applyCounter(const CounterDecodeTask& task) -> void
+{
+    for (const DecodedCounterValue& decoded : task.values) {
+        ProcessInfo& process = *decoded.process;
+        const double value = decoded.value;
+
+        switch (task.metric_group)
+        {
+        case MetricGroup_Gpu: {
+            const GpuInstanceKey& key = decoded.gpu;
+            auto& gpu = process.gpus[key.gpu_index];
+
+            gpu.gpu_index = key.gpu_index;
+
+            gpu.luid.low = key.luid_low;
+            gpu.luid.high = key.luid_high;
+
+            auto& eng = gpu.engines[key.engine_index];
+            eng.engine_index = key.engine_index;
+
+            if (key.engine_type != GpuEngine_None)
+                eng.engine_type = key.engine_type;
+
+            switch (task.metric)
+            {
+            case GpuMetric_Dedicated_Vram:
+                gpu.memory.dedicated_vram_usage = static_cast<size_t>(value);
+                break;
+            case GpuMetric_Shared_Vram:
+                gpu.memory.shared_vram_usage = static_cast<size_t>(value);
+                break;
+            case GpuMetric_Engine_Utilization:
+                eng.utilization_percentage = static_cast<float>(value);
+                break;
+            }
+            break;
+        }
+
+        case MetricGroup_Cpu:
+            switch (task.metric)
+            {
+            case CpuMetric_User_Time:
+                process.cpu.user_cpu_usage = value;
+                break;
+            case CpuMetric_Priviledged_Time:
+                process.cpu.kernel_cpu_usage = value;
+                break;
+            case CpuMetric_Total_Time:
+                process.cpu.total_cpu_usage = value;
+                break;
+            }
+            break;
+
+        case MetricGroup_Memory:
+            switch (task.metric)
+            {
+            case MemoryMetric_Working_Set:
+                process.memory_usage = static_cast<size_t>(value);
+                break;
+            case MemoryMetric_Page_Faults:
+                process.faults.minor_per_second = value;
+                break;
+            }
+            break;
+
+        case MetricGroup_Disk:
+            switch (task.metric)
+            {
+            case IoMetric_Read_Bytes:
+                process.io.read_bytes_per_second = value;
+                break;
+            case IoMetric_Write_Bytes:
+                process.io.write_bytes_per_second = value;
+                break;
+            case IoMetric_Read_Operations:
+                process.io.read_calls_per_second = value;
+                break;
+            case IoMetric_Write_Operations:
+                process.io.write_calls_per_second = value;
+                break;
+            }
+            break;
+        }
+    }
+}
+
+auto PdhProcessSampler::calculateCoreMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, CoreMetric_Type type) -> void
+{
+    if (counter == nullptr)
+        return;
+
+    PDH_STATUS result = {};
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA)
+        return;
+
+    std::vector<std::byte> buffer(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, items);
+    if (result != ERROR_SUCCESS)
+        return;
+
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (items[i].FmtValue.CStatus != ERROR_SUCCESS)
+            continue;
+
+        // Instances are "<group>,<number>", the per-group and system totals end in "_Total".
+        uint32_t group = 0;
+        uint32_t number = 0;
+        if (strstr(items[i].szName, "_Total") != nullptr || sscanf_s(items[i].szName, "%u,%u", &group, &number) != 2)
+            continue;
+
+        const uint32_t core_index = group * 64 + number;
+        auto core = std::ranges::find(system.cores, core_index, &CpuCoreInfo::core_index);
+        if (core == system.cores.end()) {
+            if (type != CoreMetric_Processor_Time)
+                continue;
+            CpuCoreInfo added = {};
+            added.core_index = core_index;
+            core = system.cores.insert(core, added);
+        }
+
+        const double value = items[i].FmtValue.doubleValue;
+        switch (type)
+        {
+        case CoreMetric_Processor_Time:
+            core->busy_percentage = static_cast<float>(std::min(value, 100.0));
+            break;
+        case CoreMetric_Idle_Time:
+            core->idle_percentage = static_cast<float>(std::min(value, 100.0));
+            break;
+        case CoreMetric_Frequency:
+            core->frequency_mhz = static_cast<uint32_t>(value);
+            break;
+        case CoreMetric_Performance:
+            core->frequency_mhz = static_cast<uint32_t>(core->frequency_mhz * value / 100.0);
+            break;
+        }
+    }
+}
+
+auto PdhProcessSampler::calculateDiskMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, DiskMetric_Type type) -> void
+{
+    PDH_STATUS result = {};
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA)
+        return;
+
+    std::vector<std::byte> buffer(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, items);
+    if (result != ERROR_SUCCESS)
+        return;
+
+    for (DWORD i = 0; i < itemCount; ++i) {
+        // Instances are "<disk number> <drive letters>", ie. "0 C: D:", plus "_Total".
+        if (items[i].FmtValue.CStatus != ERROR_SUCCESS || strcmp(items[i].szName, "_Total") == 0)
+            continue;
+
+        const std::string_view name = items[i].szName;
+        auto disk = std::ranges::find(system.disks, name, &DiskInfo::name);
+        if (disk == system.disks.end()) {
+            if (type != DiskMetric_Read_Bytes)
+                continue;
+            DiskInfo added = {};
+            added.name.assign(name);
+            disk = system.disks.insert(disk, std::move(added));
+        }
+
+        const double value = items[i].FmtValue.doubleValue;
+        switch (type)
+        {
+        case DiskMetric_Read_Bytes:
+            disk->read_bytes_per_second = value;
+            break;
+        case DiskMetric_Write_Bytes:
+            disk->write_bytes_per_second = value;
+            break;
+        case DiskMetric_Idle_Time:
+            disk->utilization_percentage = static_cast<float>(100.0 - std::clamp(value, 0.0, 100.0));
+            break;
+        case DiskMetric_Queue_Length:
+            disk->queue_depth = static_cast<float>(value);
+            break;
+        case DiskMetric_Transfer_Time:
+            disk->latency_ms = static_cast<float>(value * 1000.0);
+            break;
+        }
+    }
+}
+
+auto PdhProcessSampler::calculateThermalMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, ThermalMetric_Type type) -> void
+{
+    if (counter == nullptr)
+        return;
+
+    PDH_STATUS result = {};
+
+    DWORD bufferSize = 0;
+    DWORD itemCount = 0;
+
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, nullptr);
+    if (result != PDH_MORE_DATA)
+        return;
+
+    std::vector<std::byte> buffer(bufferSize);
+    auto* items = reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM*>(buffer.data());
+    result = PdhGetFormattedCounterArrayA(counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, &bufferSize, &itemCount, items);
+    if (result != ERROR_SUCCESS)
+        return;
+
+    for (DWORD i = 0; i < itemCount; ++i) {
+        if (items[i].FmtValue.CStatus != ERROR_SUCCESS)
+            continue;
+
+        const double value = items[i].FmtValue.doubleValue;
+        switch (type)
+        {
+        case ThermalMetric_Temperature:
+            // Kelvin
+            system.thermal.cpu_temperature = std::max(system.thermal.cpu_temperature, static_cast<float>(value - 273.15));
+            system.has_thermal = true;
+            break;
+        case ThermalMetric_Passive_Limit:
+            system.thermal.cpu_throttled |= value < 100.0;
+            break;
+        case ThermalMetric_Throttle_Reasons:
+            system.thermal.cpu_throttled |= value != 0.0;
+            break;
+        }
+    }
+}
+
+auto PdhProcessSampler::readAdapterThermal(SystemInfo& system) -> void
+{
+    if (thermal_adapter_ == 0)
+        return;
+
+    // Temperature is in tenths of a degree, drivers that don't report it leave it at 0.
+    D3DKMT_ADAPTER_PERFDATA adapter = {};
+    D3DKMT_QUERYADAPTERINFO query = {};
+    query.hAdapter = thermal_adapter_;
+    query.Type = KMTQAITYPE_ADAPTERPERFDATA;
+    query.pPrivateDriverData = &adapter;
+    query.PrivateDriverDataSize = sizeof(adapter);
+    if (D3DKMTQueryAdapterInfo(&query) >= 0) {
+        system.thermal.gpu_temperature = static_cast<float>(adapter.Temperature) / 10.0f;
+        system.thermal.fan_rpm = static_cast<uint32_t>(adapter.FanRPM);
+        system.has_thermal |= adapter.Temperature > 0;
+    }
+
+    // Node 0 is the 3D engine, clocks are in Hz.
+    D3DKMT_NODE_PERFDATA node = {};
+    node.NodeOrdinal = 0;
+    query.Type = KMTQAITYPE_NODEPERFDATA;
+    query.pPrivateDriverData = &node;
+    query.PrivateDriverDataSize = sizeof(node);
+    if (D3DKMTQueryAdapterInfo(&query) >= 0) {
+        system.thermal.gpu_clock_mhz = static_cast<uint32_t>(node.Frequency / 1'000'000);
+        system.thermal.gpu_max_clock_mhz = static_cast<uint32_t>(node.MaxFrequency / 1'000'000);
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#define NOMINMAX
+#include <Windows.h>
+#include <pdh.h>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <memory>
+
+#include <core/AdapterRegistry.hpp>
+#include <core/ProcessSampler.hpp>
+#include <core/RateCounter.hpp>
+#include <core/WorkerPool.hpp>
+#include <core/sampler/GpuInstanceName.hpp>
+
+enum GpuMetric_Type : uint8_t {
+    GpuMetric_Unknown = 0,
+    GpuMetric_Dedicated_Vram = 1,
+    GpuMetric_Shared_Vram = 2,
+    GpuMetric_Engine_Utilization = 3,
+};
+
+enum CpuMetric_Type : uint8_t {
+    CpuMetric_Unknown = 0,
+    CpuMetric_User_Time = 1,
+    CpuMetric_Priviledged_Time = 2,
+    CpuMetric_Total_Time = 3,
+};
+
+enum MemoryMetric_Type : uint8_t {
+    MemoryMetric_Unknown = 0,
+    MemoryMetric_Working_Set = 1,
+    MemoryMetric_Page_Faults = 2,
+};
+
+enum IoMetric_Type : uint8_t {
+    IoMetric_Unknown = 0,
+    IoMetric_Read_Bytes = 1,
+    IoMetric_Write_Bytes = 2,
+    IoMetric_Read_Operations = 3,
+    IoMetric_Write_Operations = 4,
+};
+
+enum DiskMetric_Type : uint8_t {
+    DiskMetric_Unknown = 0,
+    DiskMetric_Read_Bytes = 1,
+    DiskMetric_Write_Bytes = 2,
+    DiskMetric_Idle_Time = 3,
+    DiskMetric_Queue_Length = 4,
+    DiskMetric_Transfer_Time = 5,
+};
+
+enum ThermalMetric_Type : uint8_t {
+    ThermalMetric_Unknown = 0,
+    ThermalMetric_Temperature = 1,
+    ThermalMetric_Passive_Limit = 2,
+    ThermalMetric_Throttle_Reasons = 3,
+};
+
+enum CoreMetric_Type : uint8_t {
+    CoreMetric_Unknown = 0,
+    CoreMetric_Processor_Time = 1,
+    CoreMetric_Idle_Time = 2,
+    CoreMetric_Frequency = 3,
+    CoreMetric_Performance = 4,
+};
+
+struct InstanceNameHash {
+    using is_transparent = void;
+    auto operator()(std::string_view name) const -> size_t { return std::hash<std::string_view>{}(name); }
+};
+
+// Value of one instance of a per-process counter, resolved to its process by a decoding worker.
+struct DecodedCounterValue {
+    ProcessInfo* process;
+    GpuInstanceKey gpu;     // only set for GPU counters
+    double value;
+};
+
+// One per-process counter array of Sample(). Every array is decoded by a worker
+// into its own partial table, the tables are applied in registration order afterwards.
+struct CounterDecodeTask {
+    PDH_HCOUNTER counter;
+    uint32_t metric_group;      // MetricGroup_Flags the counter is sampled for
+    uint8_t metric;             // GpuMetric_Type, CpuMetric_Type, MemoryMetric_Type or IoMetric_Type depending on metric_group
+    const char* name;           // for error messages, null if the counter is optional
+    bool failed;                // the array size could not be read
+    GpuInstanceCache instances; // GPU counters only, the cache isn't thread safe so every array has its own
+    std::vector<std::byte> buffer;
+    std::vector<DecodedCounterValue> values;
+};
+
+// Thread of the focused process, the handle keeps its tid from being reused.
+struct FocusThread {
+    HANDLE handle;
+    RateCounter<1> cpu_time;    // user + kernel in 100ns units
+    bool sampled;
+    std::string name;
+};
+
+class PdhProcessSampler : public ProcessSampler {
+public:
+    explicit PdhProcessSampler();
+
+    auto Initialize() -> bool override;
+    auto Destroy() -> void override;
+    auto Sample(ProcessTable& table, uint32_t metric_groups) -> void override;
+    auto SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool override;
+    auto SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool override;
+    auto SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void override;
+
+    // Windows has no proportional set size, pss is left at 0 and uss is the private working set.
+    auto SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool override;
+
+    // PDH only reports live instances, exits are logged at the tick that noticed them.
+    auto TakeExits(std::vector<ProcessExit>& exits) -> void override;
+private:
+    auto mapProcessesToPid(ProcessTable& table, PDH_HCOUNTER counter) -> void;
+    auto mapParentProcesses(ProcessTable& table, PDH_HCOUNTER counter) -> void;
+    auto addDecodeTask(PDH_HCOUNTER counter, uint32_t metric_group, uint8_t metric, const char* name) -> void;
+    auto decodeCounter(ProcessTable& table, CounterDecodeTask& task) -> void;
+    auto applyCounter(const CounterDecodeTask& task) -> void;
+    auto calculateDiskMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, DiskMetric_Type type) -> void;
+    auto calculateThermalMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, ThermalMetric_Type type) -> void;
+    auto readAdapterThermal(SystemInfo& system) -> void;
+    auto calculateCoreMetricFromCounter(SystemInfo& system, PDH_HCOUNTER counter, CoreMetric_Type type) -> void;
+    auto findProcessByInstance(ProcessTable& table, const char* instance) -> ProcessInfo*;
+
+    // PDH instance name (ie. "chrome#2") to pid, names shift between processes so it is refreshed every tick.
+    std::unordered_map<std::string, uint32_t, InstanceNameHash, std::equal_to<>> process_map_;
+    std::vector<CounterDecodeTask> decode_tasks_;
+    std::vector<CounterDecodeTask*> active_tasks_;     // decode_tasks_ sampled this tick
+    WorkerPool decode_workers_;
+    PDH_HQUERY pdh_query_;
+    PDH_HQUERY pdh_gpu_query_;
+    PDH_HCOUNTER pdh_processes_id_counter_;
+    PDH_HCOUNTER pdh_parent_process_id_counter_;
+	PDH_HCOUNTER pdh_dedicated_vram_counter_;
+    PDH_HCOUNTER pdh_shared_vram_counter_;
+	PDH_HCOUNTER pdh_gpu_utilization_counter_;
+	PDH_HCOUNTER pdh_user_process_time_;
+    PDH_HCOUNTER pdh_kernel_process_time_;
+    PDH_HCOUNTER pdh_total_process_time_;
+    PDH_HCOUNTER pdh_process_memory_;
+    PDH_HCOUNTER pdh_process_page_faults_;
+
+    // Per-process I/O, in its own query like the GPU counters. Null if the counters are unavailable.
+    PDH_HQUERY pdh_io_query_;
+    PDH_HCOUNTER pdh_process_read_bytes_;
+    PDH_HCOUNTER pdh_process_write_bytes_;
+    PDH_HCOUNTER pdh_process_read_operations_;
+    PDH_HCOUNTER pdh_process_write_operations_;
+
+    // Per-core counters, only touched by SampleSystem(). Optional, the query is null if they are unavailable.
+    PDH_HQUERY pdh_core_query_;
+    PDH_HCOUNTER pdh_core_processor_time_;
+    PDH_HCOUNTER pdh_core_idle_time_;
+    PDH_HCOUNTER pdh_core_frequency_;
+    PDH_HCOUNTER pdh_core_performance_;
+
+    // Physical disk counters, only touched by SampleSystem(). Optional like the per-core ones.
+    PDH_HQUERY pdh_disk_query_;
+    PDH_HCOUNTER pdh_disk_read_bytes_;
+    PDH_HCOUNTER pdh_disk_write_bytes_;
+    PDH_HCOUNTER pdh_disk_idle_time_;
+    PDH_HCOUNTER pdh_disk_queue_length_;
+    PDH_HCOUNTER pdh_disk_transfer_time_;
+
+    // ACPI thermal zones, only touched by SampleSystem(). Optional, most desktop boards expose none.
+    PDH_HQUERY pdh_thermal_query_;
+    PDH_HCOUNTER pdh_thermal_temperature_;
+    PDH_HCOUNTER pdh_thermal_passive_limit_;
+    PDH_HCOUNTER pdh_thermal_throttle_reasons_;
+    uint32_t thermal_adapter_;      // D3DKMT_HANDLE of the GPU with the most dedicated memory, 0 if none could be opened
+    uint32_t base_clock_mhz_;       // nominal CPU clock from the registry
+    SYSTEM_INFO system_info_;
+    MEMORYSTATUSEX system_memory_;
+    std::unique_ptr<AdapterRegistry> adapters_;
+
+    // Focused sampling goes through the process handle instead of PDH, only touched by SampleFocus().
+    HANDLE focus_process_;
+    uint32_t focus_pid_;
+    RateCounter<2> focus_cpu_time_;     // user, kernel in 100ns units
+    RateCounter<1> focus_page_faults_;
+
+    // Only touched by SampleThreads().
+    std::unordered_map<uint32_t, FocusThread> focus_threads_;
+    std::vector<ThreadInfo> focus_thread_rows_;
+    std::vector<ThreadInfo> focus_busiest_threads_;
+    uint32_t focus_threads_pid_;
+    uint64_t focus_threads_sample_ns_;
+};
\ No newline at end of file
@@ -0,0 +1,448 @@
+#include "ProcfsLifecycle.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+// include/uapi/linux/cn_proc.h, the enum is nested in proc_event before 6.6 and at namespace scope after.
+constexpr uint32_t ProcEventNone = 0x00000000;
+constexpr uint32_t ProcEventFork = 0x00000001;
+constexpr uint32_t ProcEventExit = 0x80000000;
+
+// epoll keys of the two descriptors that aren't pidfds, pids never get this large.
+constexpr uint64_t WakeKey = UINT64_MAX;
+constexpr uint64_t SocketKey = UINT64_MAX - 1;
+
+// A fork storm (ie. a parallel build) produces tens of thousands of events per second, the
+// listener is woken for every batch but the socket buffer has to cover it being descheduled.
+constexpr int ConnectorBufferSize = 1024 * 1024;
+
+// The subscription is acknowledged right away, a missing acknowledgement means it was ignored.
+constexpr int ConnectorAckPolls = 5;
+constexpr int ConnectorAckPollMs = 50;
+
+// The connector reports the exit of a thread group leader even if other threads of the process keep
+// running, the set is rebuilt from a listing every so many updates so such a process doesn't stay hidden.
+constexpr uint64_t ResyncUpdates = 120;
+
+// Without an Update() for this long sampling is considered suspended and the subscription is dropped.
+constexpr uint64_t IdleUnsubscribeNs = 5'000'000'000;
+
+// Events queued for Update() before the subscription is dropped regardless, about 1.5 MiB.
+constexpr size_t PendingLimit = 64 * 1024;
+
+static auto monotonicNs() -> uint64_t
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+static auto pidfdOpen(uint32_t pid) -> int
+{
+    return static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+}
+
+// Calls fn for every event queued on the non-blocking socket fd. Returns false if the
+// socket overflowed and dropped events, or failed.
+template <typename Fn>
+static auto drainProcEvents(int fd, Fn&& fn) -> bool
+{
+    alignas(nlmsghdr) char buffer[4096];
+
+    while (true) {
+        sockaddr_nl sender = {};
+        socklen_t sender_size = sizeof(sender);
+        ssize_t length = recvfrom(fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&sender), &sender_size);
+        if (length < 0) {
+            if (errno == EINTR)
+                continue;
+            // ENOBUFS, the buffer overflowed and events were dropped.
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        // Anyone may send to the socket, only the kernel is trusted.
+        if (sender.nl_pid != 0)
+            continue;
+
+        for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP)
+                continue;
+
+            const cn_msg* message = static_cast<const cn_msg*>(NLMSG_DATA(header));
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+                continue;
+
+            // The payload isn't aligned for the 64 bit timestamp.
+            proc_event event = {};
+            memcpy(&event, message->data, std::min<size_t>(message->len, sizeof(event)));
+            fn(event);
+        }
+    }
+}
+
+static auto sendConnectorOp(int fd, proc_cn_mcast_op op) -> bool
+{
+    alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(op))] = {};
+
+    nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = static_cast<uint32_t>(getpid());
+
+    cn_msg* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(op);
+    memcpy(message->data, &op, sizeof(op));
+
+    return send(fd, buffer, header->nlmsg_len, 0) == static_cast<ssize_t>(header->nlmsg_len);
+}
+
+// Joins or leaves the multicast group along with the subscription, the kernel keeps sending
+// to every member of the group as long as any other process is subscribed.
+static auto setSubscribed(int fd, bool subscribed) -> bool
+{
+    const int group = CN_IDX_PROC;
+    if (!subscribed) {
+        sendConnectorOp(fd, PROC_CN_MCAST_IGNORE);
+        return setsockopt(fd, SOL_NETLINK, NETLINK_DROP_MEMBERSHIP, &group, sizeof(group)) == 0;
+    }
+
+    return setsockopt(fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group, sizeof(group)) == 0 && sendConnectorOp(fd, PROC_CN_MCAST_LISTEN);
+}
+
+ProcfsLifecycle::ProcfsLifecycle()
+{
+    source_ = ProcessEventSource_None;
+    socket_fd_ = -1;
+    epoll_fd_ = -1;
+    wake_fd_ = -1;
+    pending_.clear();
+    lost_ = false;
+    subscribed_.store(false);
+    last_update_ns_.store(0);
+    applied_.clear();
+    pids_.clear();
+    pidfds_.clear();
+    reported_exits_.clear();
+    max_pidfds_ = 0;
+    exits_.clear();
+    trusted_ = false;
+    updates_ = 0;
+}
+
+auto ProcfsLifecycle::Initialize(size_t max_pidfds) -> ProcessEventSource_Type
+{
+    max_pidfds_ = max_pidfds;
+    last_update_ns_.store(monotonicNs());
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event wake = { .events = EPOLLIN, .data = { .u64 = WakeKey } };
+    if (epoll_fd_ < 0 || wake_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake) != 0) {
+        Destroy();
+        return ProcessEventSource_None;
+    }
+
+    if (openConnector()) {
+        source_ = ProcessEventSource_Connector;
+    }
+    else if (int fd = pidfdOpen(static_cast<uint32_t>(getpid())); fd >= 0) {
+        close(fd);
+        source_ = ProcessEventSource_Pidfd;
+        printf("Process connector is not available, /proc is listed every tick and exits are tracked through pidfds.\n\n");
+    }
+    else {
+        Destroy();
+        return ProcessEventSource_None;
+    }
+
+    listener_ = std::jthread([this](std::stop_token stop_token) { listen(stop_token); });
+    return source_;
+}
+
+auto ProcfsLifecycle::Destroy() -> void
+{
+    if (listener_.joinable()) {
+        listener_.request_stop();
+        listener_.join();
+    }
+
+    closeConnector();
+
+    for (auto& [pid, fd] : pidfds_)
+        close(fd);
+    pidfds_.clear();
+    reported_exits_.clear();
+
+    if (epoll_fd_ >= 0)
+        close(epoll_fd_);
+    if (wake_fd_ >= 0)
+        close(wake_fd_);
+    epoll_fd_ = -1;
+    wake_fd_ = -1;
+
+    source_ = ProcessEventSource_None;
+    pending_.clear();
+    lost_ = false;
+    pids_.clear();
+    exits_.clear();
+    trusted_ = false;
+    updates_ = 0;
+}
+
+auto ProcfsLifecycle::Update() -> bool
+{
+    last_update_ns_.store(monotonicNs(), std::memory_order_relaxed);
+
+    // Events between dropping the subscription and renewing it are missing, the set has to be listed again.
+    bool lost = false;
+    if (source_ == ProcessEventSource_Connector && !subscribed_.load(std::memory_order_acquire)) {
+        lost = true;
+        if (setSubscribed(socket_fd_, true))
+            subscribed_.store(true, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        applied_.swap(pending_);
+        lost |= lost_;
+        lost_ = false;
+    }
+
+    if (lost || source_ != ProcessEventSource_Connector || ++updates_ >= ResyncUpdates)
+        trusted_ = false;
+
+    for (const ProcfsLifecycleEvent& event : applied_) {
+        // Events older than the next listing are already reflected by it, only the exits are kept.
+        if (trusted_) {
+            auto it = std::ranges::lower_bound(pids_, event.pid);
+            const bool known = it != pids_.end() && *it == event.pid;
+
+            if (event.exited && known)
+                pids_.erase(it);
+            else if (!event.exited && !known)
+                pids_.insert(it, event.pid);
+        }
+
+        if (!event.exited)
+            continue;
+
+        if (auto it = pidfds_.find(event.pid); it != pidfds_.end()) {
+            close(it->second);
+            pidfds_.erase(it);
+            reported_exits_.insert(event.pid);
+        }
+
+        const bool has_status = event.status >= 0;
+        exits_.push_back({
+            .pid = event.pid,
+            .exit_time = event.time_ns,
+            .exit_code = has_status && WIFEXITED(event.status) ? WEXITSTATUS(event.status) : 0,
+            .signal = has_status && WIFSIGNALED(event.status) ? WTERMSIG(event.status) : 0,
+            .has_status = has_status,
+        });
+    }
+
+    applied_.clear();
+    return trusted_;
+}
+
+auto ProcfsLifecycle::Reset(const std::vector<uint32_t>& pids) -> void
+{
+    pids_.assign(pids.begin(), pids.end());
+    std::ranges::sort(pids_);
+    trusted_ = source_ == ProcessEventSource_Connector;
+    updates_ = 0;
+
+    if (source_ != ProcessEventSource_Pidfd)
+        return;
+
+    // A zombie stays listed until it is reaped, its exit was reported once already.
+    std::erase_if(reported_exits_, [&](uint32_t pid) { return !std::ranges::binary_search(pids_, pid); });
+
+    // A pidfd of a process that already exited is readable right away, its exit is timestamped a little late.
+    for (uint32_t pid : pids_) {
+        if (pidfds_.size() >= max_pidfds_)
+            break;
+        if (pidfds_.contains(pid) || reported_exits_.contains(pid))
+            continue;
+
+        int fd = pidfdOpen(pid);
+        if (fd < 0)
+            continue;
+
+        // One-shot, the descriptor is closed by Update() once the exit was applied.
+        epoll_event exit = { .events = EPOLLIN | EPOLLONESHOT, .data = { .u64 = pid } };
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &exit) != 0) {
+            close(fd);
+            continue;
+        }
+
+        pidfds_.emplace(pid, fd);
+    }
+}
+
+auto ProcfsLifecycle::TakeExits(std::vector<ProcessExit>& exits) -> void
+{
+    exits.swap(exits_);
+    exits_.clear();
+}
+
+auto ProcfsLifecycle::openConnector() -> bool
+{
+    socket_fd_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (socket_fd_ < 0)
+        return false;
+
+    // Joining the group is what needs CAP_NET_ADMIN, SO_RCVBUFFORCE does as well.
+    sockaddr_nl address = { .nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = CN_IDX_PROC };
+    if (bind(socket_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !sendConnectorOp(socket_fd_, PROC_CN_MCAST_LISTEN)) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+
+    if (setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUFFORCE, &ConnectorBufferSize, sizeof(ConnectorBufferSize)) != 0)
+        setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, &ConnectorBufferSize, sizeof(ConnectorBufferSize));
+
+    // The kernel acknowledges the subscription. Before 6.6 it refuses it without CAP_NET_ADMIN and
+    // ignores it from outside the initial pid namespace, no events would ever arrive in both cases.
+    bool acknowledged = false;
+    bool subscribed = false;
+    for (int i = 0; i < ConnectorAckPolls && !acknowledged; ++i) {
+        pollfd readable = { .fd = socket_fd_, .events = POLLIN, .revents = 0 };
+        if (poll(&readable, 1, ConnectorAckPollMs) < 0 && errno != EINTR)
+            break;
+
+        drainProcEvents(socket_fd_, [&](const proc_event& event) {
+            if (static_cast<uint32_t>(event.what) == ProcEventNone && !acknowledged) {
+                acknowledged = true;
+                subscribed = event.event_data.ack.err == 0;
+            }
+        });
+    }
+
+    if (!subscribed) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+
+    subscribed_.store(true, std::memory_order_relaxed);
+
+    epoll_event readable = { .events = EPOLLIN, .data = { .u64 = SocketKey } };
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd_, &readable) != 0) {
+        closeConnector();
+        return false;
+    }
+
+    return true;
+}
+
+auto ProcfsLifecycle::closeConnector() -> void
+{
+    if (socket_fd_ < 0)
+        return;
+
+    // The kernel stops generating events after the last listener unsubscribed, it counts them without a floor.
+    if (subscribed_.load(std::memory_order_relaxed))
+        sendConnectorOp(socket_fd_, PROC_CN_MCAST_IGNORE);
+    subscribed_.store(false, std::memory_order_relaxed);
+    close(socket_fd_);
+    socket_fd_ = -1;
+}
+
+auto ProcfsLifecycle::listen(std::stop_token stop_token) -> void
+{
+    std::stop_callback wake(stop_token, [this] {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+    });
+
+    std::vector<ProcfsLifecycleEvent> events = {};
+    epoll_event ready[64] = {};
+
+    while (!stop_token.stop_requested()) {
+        const int count = epoll_wait(epoll_fd_, ready, static_cast<int>(std::size(ready)), -1);
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        bool lost = count < 0;
+        for (int i = 0; i < count; ++i) {
+            const uint64_t key = ready[i].data.u64;
+            if (key == WakeKey)
+                continue;
+
+            if (key == SocketKey)
+                lost |= !receiveEvents(events);
+            else
+                events.push_back({ .pid = static_cast<uint32_t>(key), .exited = true, .time_ns = monotonicNs(), .status = -1 });
+        }
+
+        if (events.empty() && !lost)
+            continue;
+
+        // Nothing applies the events while sampling is suspended. Instead of queueing every fork on the
+        // system the subscription is dropped, the next Update() subscribes again and has /proc listed.
+        // Exits received until then are dropped with it and logged at the tick that notices them.
+        const bool idle = monotonicNs() - last_update_ns_.load(std::memory_order_relaxed) > IdleUnsubscribeNs;
+        bool unsubscribe = false;
+        {
+            std::lock_guard lock(mutex_);
+            pending_.insert(pending_.end(), events.begin(), events.end());
+            lost_ |= lost;
+
+            if (source_ == ProcessEventSource_Connector && subscribed_.load(std::memory_order_relaxed) && (idle || pending_.size() > PendingLimit)) {
+                pending_.clear();
+                pending_.shrink_to_fit();
+                lost_ = true;
+                unsubscribe = true;
+            }
+        }
+        events.clear();
+
+        if (unsubscribe) {
+            setSubscribed(socket_fd_, false);
+            subscribed_.store(false, std::memory_order_release);
+        }
+    }
+}
+
+auto ProcfsLifecycle::receiveEvents(std::vector<ProcfsLifecycleEvent>& events) -> bool
+{
+    return drainProcEvents(socket_fd_, [&events](const proc_event& event) {
+        // Threads are reported as well, only the thread group leaders are processes.
+        if (static_cast<uint32_t>(event.what) == ProcEventFork && event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+            events.push_back({
+                .pid = static_cast<uint32_t>(event.event_data.fork.child_tgid),
+                .exited = false,
+                .time_ns = event.timestamp_ns,
+                .status = -1,
+            });
+        }
+        else if (static_cast<uint32_t>(event.what) == ProcEventExit && event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+            events.push_back({
+                .pid = static_cast<uint32_t>(event.event_data.exit.process_tgid),
+                .exited = true,
+                .time_ns = event.timestamp_ns,
+                .status = static_cast<int32_t>(event.event_data.exit.exit_code),
+            });
+        }
+    });
+}
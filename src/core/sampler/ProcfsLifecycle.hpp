@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <core/ProcessInfo.hpp>
+
+enum ProcessEventSource_Type : uint32_t {
+    ProcessEventSource_None = 0,
+    ProcessEventSource_Connector = 1,   // netlink proc connector, births and exits, needs CAP_NET_ADMIN
+    ProcessEventSource_Pidfd = 2,       // a pidfd per listed process, exits only
+};
+
+// A birth or an exit received by the listener thread, applied in order by ProcfsLifecycle::Update().
+struct ProcfsLifecycleEvent {
+    uint32_t pid;
+    bool exited;
+    uint64_t time_ns;       // CLOCK_MONOTONIC
+    int32_t status;         // wait status of an exit, -1 if unknown
+};
+
+// Keeps the set of live pids current between ticks from process lifecycle
+// events, so a tick only reads the pids it knows about instead of listing /proc,
+// and records when every process exited.
+//
+// Events are received on a listener thread and applied by the sampling thread
+// at the start of a tick. With the proc connector the set only has to be
+// rebuilt from a listing of /proc once, and again if the socket dropped events or
+// the subscription was dropped while sampling was suspended.
+// Without it every listed process gets a pidfd that becomes readable when it
+// exits, births are still found by listing /proc every tick.
+class ProcfsLifecycle {
+public:
+    explicit ProcfsLifecycle();
+
+    // max_pidfds bounds the descriptors held by the pidfd fallback, exits of processes past it are not timestamped.
+    // Returns ProcessEventSource_None if neither source is available, the object is not used afterwards.
+    auto Initialize(size_t max_pidfds) -> ProcessEventSource_Type;
+    auto Destroy() -> void;
+
+    [[nodiscard]] auto Source() const -> ProcessEventSource_Type { return source_; }
+
+    // Ascending pids, only current after Update() returned true.
+    [[nodiscard]] auto Pids() const -> const std::vector<uint32_t>& { return pids_; }
+
+    // Applies the events received since the previous call. Returns false if /proc has to
+    // be listed and passed to Reset(): before the first listing, after events were lost,
+    // periodically to catch what the events don't report and always with the pidfd fallback.
+    auto Update() -> bool;
+
+    // Replaces the pid set with a listing of /proc, events received while it was
+    // listed are applied on top by the next Update().
+    auto Reset(const std::vector<uint32_t>& pids) -> void;
+
+    // Moves the exits applied by Update() since the previous call into exits.
+    auto TakeExits(std::vector<ProcessExit>& exits) -> void;
+private:
+    auto openConnector() -> bool;
+    auto closeConnector() -> void;
+    auto listen(std::stop_token stop_token) -> void;
+    auto receiveEvents(std::vector<ProcfsLifecycleEvent>& events) -> bool;
+
+    ProcessEventSource_Type source_;
+    int socket_fd_;
+    int epoll_fd_;
+    int wake_fd_;
+    std::jthread listener_;
+
+    std::mutex mutex_;      // guards pending_ and lost_, shared with the listener thread
+    std::vector<ProcfsLifecycleEvent> pending_;
+    bool lost_;             // the socket overflowed or the subscription was dropped, the pid set misses events
+    std::atomic<bool> subscribed_;          // dropped by the listener while no Update() comes, renewed by Update()
+    std::atomic<uint64_t> last_update_ns_;
+
+    std::vector<ProcfsLifecycleEvent> applied_;     // only touched by Update()
+    std::vector<uint32_t> pids_;
+    std::unordered_map<uint32_t, int> pidfds_;
+    std::unordered_set<uint32_t> reported_exits_;   // exits applied while the zombie is still listed, not armed again
+    size_t max_pidfds_;
+    std::vector<ProcessExit> exits_;
+    bool trusted_;          // pids_ was built from a listing and no event was lost since
+    uint64_t updates_;      // since the last listing
+};
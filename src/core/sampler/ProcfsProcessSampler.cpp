@@ -0,0 +1,1550 @@
+#include "ProcfsProcessSampler.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <stdio.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Descriptors left for the rest of the overlay (Vulkan, OpenVR, ...) once cached ones hit the limit.
+constexpr size_t ReservedDescriptors = 256;
+
+// include/linux/sched.h
+constexpr uint64_t PF_KTHREAD = 0x00200000;
+
+// Pids read by a sampling worker at a time, a few hundred reads are enough to make up for handing out the chunk.
+constexpr size_t SampleChunkSize = 64;
+
+// Descriptors are mostly opened at startup, so the fd table of a process is
+// only walked again every few ticks to pick up DRM nodes opened later on.
+constexpr uint64_t DrmFdRescanTicks = 8;
+
+// Processes are moved between cgroups by systemd and container runtimes, on the same cadence as the DRM nodes.
+constexpr uint64_t CgroupRescanTicks = DrmFdRescanTicks;
+
+// Weight of the newest sample in the thread state fractions, roughly the last 20 focus ticks are averaged.
+constexpr float ThreadStateSmoothing = 0.05f;
+
+// status is about ten times the size of schedstat, the context switch counters in it are only read every quarter second.
+constexpr uint64_t ContextSwitchIntervalNs = 250'000'000;
+
+// smaps of a large process is several megabytes, it is streamed through a buffer of this size.
+constexpr size_t SmapsChunkSize = 64 * 1024;
+
+// Sensors count as throttling this close to their critical temperature, in millidegrees Celsius. CPU sensors
+// without a critical temperature (k10temp) use the fallback, the highest Tctl current Ryzen parts boost up to.
+constexpr int64_t ThermalLimitMargin = 5'000;
+constexpr int64_t CpuFallbackThermalLimit = 95'000;
+
+static auto monotonicNs() -> uint64_t
+{
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Reads a procfs file either through the cached descriptor or, if we ran out
+// of descriptors while opening it, through a one-shot open.
+static auto readProcFile(int fd, const char* path, char* buffer, size_t size) -> ssize_t
+{
+    if (fd >= 0)
+        return pread(fd, buffer, size - 1, 0);
+
+    int oneshot_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (oneshot_fd < 0)
+        return -1;
+
+    ssize_t length = pread(oneshot_fd, buffer, size - 1, 0);
+    close(oneshot_fd);
+    return length;
+}
+
+// Parses up to count space separated unsigned integers, returns how many were parsed.
+static auto parseFields(std::string_view text, uint64_t* fields, size_t count) -> size_t
+{
+    size_t parsed = 0;
+    const char* it = text.data();
+    const char* end = text.data() + text.size();
+
+    while (parsed < count && it < end) {
+        while (it < end && *it == ' ')
+            ++it;
+        if (it >= end)
+            break;
+
+        uint64_t value = 0;
+        auto [next, ec] = std::from_chars(it, end, value);
+        if (ec != std::errc()) {
+            // non-numeric field (ie. process state), skip it.
+            while (it < end && *it != ' ')
+                ++it;
+            value = 0;
+        }
+        else {
+            it = next;
+        }
+        fields[parsed++] = value;
+    }
+
+    return parsed;
+}
+
+auto ProcessSampler::Create() -> std::unique_ptr<ProcessSampler>
+{
+    return std::make_unique<ProcfsProcessSampler>();
+}
+
+ProcfsProcessSampler::ProcfsProcessSampler(ProcfsSource source)
+{
+    source_ = std::move(source);
+    handles_.clear();
+    samples_.clear();
+    lifecycle_ = nullptr;
+    listed_pids_.clear();
+    adapters_ = nullptr;
+    drm_clients_.clear();
+    drm_engine_names_.clear();
+    focus_handle_ = {};
+    focus_handle_.stat_fd = -1;
+    focus_handle_.statm_fd = -1;
+    focus_handle_.status_fd = -1;
+    focus_handle_.io_fd = -1;
+    focus_pid_ = 0;
+    focus_threads_.clear();
+    focus_thread_rows_.clear();
+    focus_threads_pid_ = 0;
+    system_stat_fd_ = -1;
+    system_stat_buffer_.clear();
+    cores_.clear();
+    for (ProcfsPressureHandle& pressure : pressure_)
+        pressure = { .fd = -1, .totals = {} };
+    diskstats_fd_ = -1;
+    disks_.clear();
+    sensors_discovered_ = false;
+    cpu_temperature_ = { .path = {}, .fd = -1, .limit = 0 };
+    cpu_throttle_count_ = { .path = {}, .fd = -1, .limit = 0 };
+    gpu_temperature_ = { .path = {}, .fd = -1, .limit = 0 };
+    gpu_hotspot_temperature_ = { .path = {}, .fd = -1, .limit = 0 };
+    gpu_clock_ = { .path = {}, .fd = -1, .limit = 0 };
+    fans_.clear();
+    cpu_throttle_events_ = 0;
+    cpu_max_clock_mhz_ = 0;
+    gpu_max_clock_mhz_ = 0;
+    meminfo_fd_ = -1;
+    swap_total_ = 0;
+    swap_usage_ = 0;
+    detail_buffer_.clear();
+
+    tick_ = 0;
+    descriptor_limit_ = 0;
+    cached_descriptors_.store(0);
+    clock_ticks_ = 0;
+    page_size_ = 0;
+    processor_count_ = 0;
+    system_memory_ = 0;
+}
+
+auto ProcfsProcessSampler::SetRoot(std::string root) -> void
+{
+    source_.root = std::move(root);
+}
+
+auto ProcfsProcessSampler::clockNs() const -> uint64_t
+{
+    return source_.clock ? source_.clock() : monotonicNs();
+}
+
+auto ProcfsProcessSampler::Initialize() -> bool
+{
+    char path[PATH_MAX] = {};
+
+    snprintf(path, sizeof(path), "%s/proc", source_.root.c_str());
+    if (access(path, R_OK) != 0) {
+        printf("procfs is not available, performance statistics are disabled.\n\n");
+        return false;
+    }
+
+    clock_ticks_ = source_.clock_ticks > 0 ? source_.clock_ticks : sysconf(_SC_CLK_TCK);
+    page_size_ = source_.page_size > 0 ? source_.page_size : sysconf(_SC_PAGESIZE);
+    processor_count_ = source_.processor_count > 0 ? source_.processor_count : sysconf(_SC_NPROCESSORS_ONLN);
+    system_memory_ = source_.system_memory > 0
+        ? source_.system_memory
+        : static_cast<size_t>(sysconf(_SC_PHYS_PAGES)) * static_cast<size_t>(page_size_);
+
+    if (clock_ticks_ <= 0 || page_size_ <= 0 || processor_count_ <= 0)
+        return false;
+
+    // Two descriptors are kept per process, the default soft limit (1024) is easily exceeded.
+    rlimit limit = {};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // Past the budget files are read through one-shot opens, running into EMFILE would drop processes instead.
+    descriptor_limit_ = 0;
+    if (!source_.reopen_files && getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        descriptor_limit_ = limit.rlim_cur == RLIM_INFINITY
+            ? SIZE_MAX
+            : static_cast<size_t>(limit.rlim_cur) - std::min<size_t>(static_cast<size_t>(limit.rlim_cur), ReservedDescriptors);
+    }
+
+    // Births and exits of the live system are tracked through events, replays list their captured /proc.
+    if (source_.root.empty() && !source_.reopen_files) {
+        // The pidfd fallback holds a descriptor per process, it gets a quarter of the budget.
+        const size_t pidfd_limit = descriptor_limit_ / 4;
+
+        lifecycle_ = std::make_unique<ProcfsLifecycle>();
+        const ProcessEventSource_Type event_source = lifecycle_->Initialize(pidfd_limit);
+        if (event_source == ProcessEventSource_None)
+            lifecycle_.reset();
+        else if (event_source == ProcessEventSource_Pidfd)
+            descriptor_limit_ -= pidfd_limit;
+    }
+
+    adapters_ = std::make_unique<DrmAdapterRegistry>(source_.root);
+    adapters_->Refresh();
+
+    sample_workers_.Start(WorkerPool::WorkerCountFor(SIZE_MAX));
+
+    // Only the cpu lines at the top of /proc/stat are parsed, the interrupt counters after them may be cut off.
+    system_stat_buffer_.resize(4096 + static_cast<size_t>(processor_count_) * 128);
+    detail_buffer_.resize(SmapsChunkSize);
+
+    return true;
+}
+
+auto ProcfsProcessSampler::Destroy() -> void
+{
+    for (auto& [pid, handle] : handles_)
+        closeHandle(handle);
+
+    sample_workers_.Stop();
+
+    handles_.clear();
+    adapters_.reset();
+    drm_clients_.clear();
+
+    if (lifecycle_ != nullptr)
+        lifecycle_->Destroy();
+    lifecycle_.reset();
+
+    closeHandle(focus_handle_);
+    focus_pid_ = 0;
+
+    for (auto& [tid, thread] : focus_threads_)
+        closeThreadHandle(thread);
+
+    focus_threads_.clear();
+    focus_threads_pid_ = 0;
+
+    closeCached(system_stat_fd_);
+    for (ProcfsCoreHandle& core : cores_)
+        closeCached(core.frequency_fd);
+    cores_.clear();
+
+    for (ProcfsPressureHandle& pressure : pressure_) {
+        closeCached(pressure.fd);
+        pressure.totals.Reset();
+    }
+    closeCached(diskstats_fd_);
+    disks_.clear();
+
+    for (ProcfsSensor* sensor : { &cpu_temperature_, &cpu_throttle_count_, &gpu_temperature_, &gpu_hotspot_temperature_, &gpu_clock_ })
+        closeCached(sensor->fd);
+    for (ProcfsSensor& fan : fans_)
+        closeCached(fan.fd);
+    fans_.clear();
+    sensors_discovered_ = false;
+
+    closeCached(meminfo_fd_);
+}
+
+auto ProcfsProcessSampler::Sample(ProcessTable& table, uint32_t metric_groups) -> void
+{
+    ++tick_;
+
+    for (auto& [pid, handle] : handles_)
+        handle.sampled = false;
+
+    // Per-process swap is only read while something is swapped out at all.
+    if (metric_groups & MetricGroup_Memory)
+        readMeminfo();
+
+    // Cards are only re-read when one appears or disappears.
+    const bool sample_gpu = (metric_groups & MetricGroup_Gpu) && adapters_ != nullptr;
+    if (sample_gpu)
+        adapters_->Refresh();
+
+    // Between ticks the process events keep the pid set current, /proc is only listed when they can't.
+    const bool tracked = lifecycle_ != nullptr && lifecycle_->Update();
+    if (!tracked) {
+        listProcesses(listed_pids_);
+        if (lifecycle_ != nullptr)
+            lifecycle_->Reset(listed_pids_);
+    }
+
+    // Handles are added up front, the workers below must not change the map. Its nodes never move, so the pointers stay valid.
+    samples_.clear();
+    for (uint32_t pid : tracked ? lifecycle_->Pids() : listed_pids_) {
+        auto [it, inserted] = handles_.try_emplace(pid);
+        ProcfsSample& sample = samples_.emplace_back();
+        sample.pid = pid;
+        sample.handle = &it->second;
+        sample.opened = inserted;
+    }
+
+    // Reading the files of every process is most of the tick, it is spread over all cores in chunks of pids.
+    const size_t chunk_count = (samples_.size() + SampleChunkSize - 1) / SampleChunkSize;
+    sample_workers_.For(chunk_count, [&](size_t chunk) {
+        const size_t end = std::min(samples_.size(), (chunk + 1) * SampleChunkSize);
+        for (size_t index = chunk * SampleChunkSize; index < end; ++index)
+            readProcess(samples_[index], metric_groups);
+    });
+
+    // Applied in /proc order, so neither the table nor the DRM client accounting depends on which worker finished first.
+    for (const ProcfsSample& sample : samples_) {
+        ProcfsHandle& handle = *sample.handle;
+        if (!sample.valid) {
+            handles_.erase(sample.pid);
+            continue;
+        }
+
+        handle.sampled = true;
+
+        // Kernel threads are not shown, same as Task Manager not showing system processes.
+        if (handle.kernel_thread)
+            continue;
+
+        ProcessInfo& info = table.Upsert(sample.pid, handle.start_time);
+        if (metric_groups & MetricGroup_Memory) {
+            info.memory_usage = sample.memory_usage;
+            info.swap_usage = sample.swap_usage;
+            info.faults = sample.faults;
+        }
+        if (metric_groups & MetricGroup_Cpu)
+            info.cpu = sample.cpu;
+        if (metric_groups & MetricGroup_Disk)
+            info.io = sample.io;
+        if (sample_gpu)
+            readDrmClients(sample.pid, handle, info);
+
+        // Compacting the pool renumbers every string, the ids are interned again afterwards. A renamed or moved process reset name_id,
+        // the table then reports the row as changed and the tree relinks it under its new cgroup.
+        if (handle.name_id == 0 || handle.string_generation != table.StringGeneration()) {
+            handle.name_id = table.Intern(handle.process_name);
+            handle.cgroup_id = table.Intern(handle.cgroup);
+            handle.string_generation = table.StringGeneration();
+        }
+
+        info.name_id = handle.name_id;
+        info.cgroup_id = handle.cgroup_id;
+        info.parent_pid = handle.parent_pid;
+        info.memory_available = system_memory_;
+    }
+
+    for (auto it = handles_.begin(); it != handles_.end(); ) {
+        if (!it->second.sampled) {
+            closeHandle(it->second);
+            it = handles_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Forget clients whose descriptors were all closed, or every client if GPU metrics are no longer wanted.
+    std::erase_if(drm_clients_, [&](const auto& client) { return client.second.last_seen != tick_; });
+}
+
+auto ProcfsProcessSampler::SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool
+{
+    if (pid != focus_pid_) {
+        closeHandle(focus_handle_);
+        focus_pid_ = 0;
+
+        openHandle(pid, focus_handle_);
+        focus_pid_ = pid;
+    }
+
+    // A reused pid shows up as a new start time and restarts the CPU baseline inside readStat().
+    decltype(ProcessInfo::cpu) cpu = {};
+    decltype(ProcessInfo::faults) faults = {};
+    if (!readStat(pid, focus_handle_, cpu, faults)) {
+        closeHandle(focus_handle_);
+        focus_pid_ = 0;
+        return false;
+    }
+
+    info.pid = pid;
+    if (metric_groups & MetricGroup_Memory) {
+        readStatm(pid, focus_handle_, info.memory_usage);
+        info.faults = faults;
+    }
+    if (metric_groups & MetricGroup_Cpu)
+        info.cpu = cpu;
+    info.memory_available = system_memory_;
+
+    return true;
+}
+
+auto ProcfsProcessSampler::SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool
+{
+    char path[PATH_MAX] = {};
+
+    threads.clear();
+    scheduler = {};
+
+    if (pid != focus_threads_pid_) {
+        for (auto& [tid, thread] : focus_threads_)
+            closeThreadHandle(thread);
+
+        focus_threads_.clear();
+        focus_threads_pid_ = pid;
+    }
+
+    snprintf(path, sizeof(path), "%s/proc/%u/task", source_.root.c_str(), pid);
+    DIR* tasks = opendir(path);
+    if (tasks == nullptr)
+        return false;
+
+    for (auto& [tid, thread] : focus_threads_)
+        thread.sampled = false;
+
+    focus_thread_rows_.clear();
+
+    while (dirent* entry = readdir(tasks)) {
+        uint32_t tid = 0;
+        const char* name_end = entry->d_name + strlen(entry->d_name);
+        auto [ptr, ec] = std::from_chars(entry->d_name, name_end, tid);
+        if (ec != std::errc() || ptr != name_end)
+            continue;
+
+        auto [it, inserted] = focus_threads_.try_emplace(tid);
+        if (inserted && !openThreadHandle(pid, tid, it->second)) {
+            focus_threads_.erase(it);
+            continue;
+        }
+
+        ThreadInfo& thread = focus_thread_rows_.emplace_back();
+        if (!readThread(pid, tid, it->second, thread)) {
+            focus_thread_rows_.pop_back();
+            closeThreadHandle(it->second);
+            focus_threads_.erase(it);
+            continue;
+        }
+
+        it->second.sampled = true;
+    }
+
+    closedir(tasks);
+
+    for (auto it = focus_threads_.begin(); it != focus_threads_.end(); ) {
+        if (!it->second.sampled) {
+            closeThreadHandle(it->second);
+            it = focus_threads_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (const ThreadInfo& thread : focus_thread_rows_) {
+        scheduler.wait_percentage += thread.wait_percentage;
+        scheduler.voluntary_switches += thread.voluntary_switches;
+        scheduler.involuntary_switches += thread.involuntary_switches;
+    }
+
+    const size_t busiest = std::min(count, focus_thread_rows_.size());
+    std::partial_sort(focus_thread_rows_.begin(), focus_thread_rows_.begin() + busiest, focus_thread_rows_.end(),
+        [](const ThreadInfo& a, const ThreadInfo& b) { return a.cpu_usage > b.cpu_usage; });
+
+    threads.assign(std::make_move_iterator(focus_thread_rows_.begin()), std::make_move_iterator(focus_thread_rows_.begin() + busiest));
+
+    return true;
+}
+
+auto ProcfsProcessSampler::SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void
+{
+    // Keeps the capacity of cores and disks, everything else is refilled below.
+    std::vector<CpuCoreInfo> cores = std::move(system.cores);
+    std::vector<DiskInfo> disks = std::move(system.disks);
+    cores.clear();
+    disks.clear();
+    system = {};
+    system.cores = std::move(cores);
+    system.disks = std::move(disks);
+
+    if (metric_groups & MetricGroup_Cores)
+        readCores(system);
+
+    if (metric_groups & MetricGroup_Cpu)
+        system.has_pressure = readPressure("cpu", pressure_[0], system.cpu_pressure);
+
+    if (metric_groups & MetricGroup_Memory) {
+        system.has_pressure |= readPressure("memory", pressure_[1], system.memory_pressure);
+        system.has_pressure |= readPressure("io", pressure_[2], system.io_pressure);
+        system.swap_total = swap_total_;
+        system.swap_usage = swap_usage_;
+    }
+
+    if (metric_groups & MetricGroup_Disk)
+        readDisks(system);
+    else
+        disks_.clear();
+
+    // After the cores, the CPU clock is taken from their frequencies.
+    if (metric_groups & MetricGroup_Thermal)
+        readThermal(system);
+}
+
+auto ProcfsProcessSampler::TakeExits(std::vector<ProcessExit>& exits) -> void
+{
+    if (lifecycle_ != nullptr)
+        lifecycle_->TakeExits(exits);
+    else
+        exits.clear();
+}
+
+auto ProcfsProcessSampler::SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool
+{
+    char path[PATH_MAX] = {};
+
+    detail = {};
+    detail.pid = pid;
+
+    // smaps_rollup (4.14+) is summed by the kernel, walking every mapping ourselves is the fallback.
+    snprintf(path, sizeof(path), "%s/proc/%u/smaps_rollup", source_.root.c_str(), pid);
+    if (readSmaps(path, detail))
+        return true;
+
+    snprintf(path, sizeof(path), "%s/proc/%u/smaps", source_.root.c_str(), pid);
+    return readSmaps(path, detail);
+}
+
+auto ProcfsProcessSampler::readSmaps(const char* path, MemoryDetail& detail) -> bool
+{
+    // Not cached, the pss walk happens every few seconds and the files are read to their end.
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    auto parseLine = [&detail](std::string_view line) {
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            return;
+
+        const std::string_view key = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        value.remove_prefix(std::min(value.size(), value.find_first_not_of(' ')));
+
+        size_t kilobytes = 0;
+        if (std::from_chars(value.data(), value.data() + value.size(), kilobytes).ec != std::errc())
+            return;
+
+        if (key == "Rss")
+            detail.resident += kilobytes * 1024;
+        else if (key == "Pss")
+            detail.pss += kilobytes * 1024;
+        else if (key == "Private_Clean" || key == "Private_Dirty")
+            detail.uss += kilobytes * 1024;
+        else if (key == "Swap")
+            detail.swap += kilobytes * 1024;
+    };
+
+    size_t pending = 0;
+    bool parsed_any = false;
+
+    while (true) {
+        const ssize_t length = read(fd, detail_buffer_.data() + pending, detail_buffer_.size() - pending);
+        if (length < 0) {
+            close(fd);
+            return false;
+        }
+        if (length == 0)
+            break;
+
+        const std::string_view chunk(detail_buffer_.data(), pending + static_cast<size_t>(length));
+        size_t start = 0;
+
+        for (size_t end = chunk.find('\n'); end != std::string_view::npos; end = chunk.find('\n', start)) {
+            parseLine(chunk.substr(start, end - start));
+            start = end + 1;
+        }
+
+        // Keep the partial last line for the next read, no smaps line gets anywhere near the buffer size.
+        pending = chunk.size() - start;
+        if (pending == detail_buffer_.size())
+            pending = 0;
+        memmove(detail_buffer_.data(), detail_buffer_.data() + start, pending);
+        parsed_any = true;
+    }
+
+    parseLine(std::string_view(detail_buffer_.data(), pending));
+    close(fd);
+
+    // Kernel threads have an empty smaps.
+    return parsed_any && detail.resident > 0;
+}
+
+auto ProcfsProcessSampler::readCores(SystemInfo& system) -> void
+{
+    char path[PATH_MAX] = {};
+
+    if (system_stat_buffer_.empty())
+        return;
+
+    snprintf(path, sizeof(path), "%s/proc/stat", source_.root.c_str());
+    if (system_stat_fd_ < 0)
+        system_stat_fd_ = openCached(path);
+
+    const ssize_t length = readProcFile(system_stat_fd_, path, system_stat_buffer_.data(), system_stat_buffer_.size());
+    if (length <= 0)
+        return;
+
+    const uint64_t now = clockNs();
+
+    std::string_view lines(system_stat_buffer_.data(), static_cast<size_t>(length));
+    while (!lines.empty()) {
+        const size_t line_end = lines.find('\n');
+        std::string_view line = lines.substr(0, line_end);
+        lines = line_end == std::string_view::npos ? std::string_view{} : lines.substr(line_end + 1);
+
+        // The aggregate "cpu " line comes first and the per-core lines follow it, anything else ends the block.
+        if (!line.starts_with("cpu"))
+            break;
+
+        uint32_t core_index = 0;
+        auto [ptr, ec] = std::from_chars(line.data() + 3, line.data() + line.size(), core_index);
+        if (ec != std::errc())
+            continue;
+
+        // user nice system idle iowait irq softirq steal, guest time is already part of user.
+        uint64_t fields[8] = {};
+        if (parseFields(line.substr(static_cast<size_t>(ptr - line.data())), fields, 8) < 5)
+            continue;
+
+        const uint64_t idle_time = fields[3] + fields[4];
+        const uint64_t busy_time = fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7];
+
+        if (core_index >= cores_.size()) {
+            ProcfsCoreHandle unknown = {};
+            unknown.frequency_fd = -1;
+            cores_.resize(core_index + 1, unknown);
+        }
+
+        ProcfsCoreHandle& core = cores_[core_index];
+        if (!core.known) {
+            snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", source_.root.c_str(), core_index);
+            core.has_frequency = access(path, R_OK) == 0;
+            core.known = true;
+        }
+
+        // Hotplugged cores restart their counters, the first tick after that has no baseline.
+        if (!core.times.Update(0, now, { busy_time, idle_time }))
+            continue;
+
+        const uint64_t busy_delta = core.times.Delta(0);
+        const uint64_t total_delta = busy_delta + core.times.Delta(1);
+        if (total_delta == 0)
+            continue;
+
+        CpuCoreInfo& info = system.cores.emplace_back();
+        info.core_index = core_index;
+        info.busy_percentage = static_cast<float>(static_cast<double>(busy_delta) / static_cast<double>(total_delta) * 100.0);
+        info.idle_percentage = 100.0f - info.busy_percentage;
+        info.frequency_mhz = readCoreFrequency(core_index, core);
+
+        if (info.busy_percentage > system.max_core_usage) {
+            system.max_core_usage = info.busy_percentage;
+            system.max_core_index = core_index;
+        }
+    }
+}
+
+auto ProcfsProcessSampler::readCoreFrequency(uint32_t core_index, ProcfsCoreHandle& core) -> uint32_t
+{
+    if (!core.has_frequency)
+        return 0;
+
+    char path[PATH_MAX] = {};
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%u/cpufreq/scaling_cur_freq", source_.root.c_str(), core_index);
+    if (core.frequency_fd < 0)
+        core.frequency_fd = openCached(path);
+
+    // sysfs attributes are regenerated on every read from offset 0, the value is in kHz.
+    char buffer[32] = {};
+    const ssize_t length = readProcFile(core.frequency_fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return 0;
+
+    uint64_t frequency_khz = 0;
+    std::from_chars(buffer, buffer + length, frequency_khz);
+    return static_cast<uint32_t>(frequency_khz / 1000);
+}
+
+auto ProcfsProcessSampler::readPressure(const char* resource, ProcfsPressureHandle& handle, PressureInfo& pressure) -> bool
+{
+    char path[PATH_MAX] = {};
+    char buffer[256] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/pressure/%s", source_.root.c_str(), resource);
+    if (handle.fd < 0)
+        handle.fd = openCached(path);
+
+    const ssize_t length = readProcFile(handle.fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return false;
+
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=<us>", then the same for "full". The averages
+    // span 10s and more, the totals give the share of this tick so stalls line up with frame times.
+    // The cpu file has no "full" line before 5.13, its total stays at zero.
+    RateCounter<2>::Values totals = {};
+    std::string_view lines(buffer, static_cast<size_t>(length));
+    for (size_t line = 0; line < 2 && !lines.empty(); ++line) {
+        const size_t total = lines.find("total=");
+        if (total == std::string_view::npos)
+            break;
+
+        std::from_chars(lines.data() + total + 6, lines.data() + lines.size(), totals[line]);
+        const size_t line_end = lines.find('\n', total);
+        lines = line_end == std::string_view::npos ? std::string_view{} : lines.substr(line_end + 1);
+    }
+
+    // us stalled per second, 10'000 of them are 1%.
+    if (handle.totals.Update(0, clockNs(), totals)) {
+        pressure.some_percentage = static_cast<float>(std::min(100.0, handle.totals.Rate(0) / 10'000.0));
+        pressure.full_percentage = static_cast<float>(std::min(100.0, handle.totals.Rate(1) / 10'000.0));
+    }
+
+    return true;
+}
+
+auto ProcfsProcessSampler::readMeminfo() -> void
+{
+    char path[PATH_MAX] = {};
+    char buffer[4096] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/meminfo", source_.root.c_str());
+    if (meminfo_fd_ < 0)
+        meminfo_fd_ = openCached(path);
+
+    swap_total_ = 0;
+    swap_usage_ = 0;
+
+    const ssize_t length = readProcFile(meminfo_fd_, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    auto field = [text = std::string_view(buffer, static_cast<size_t>(length))](std::string_view key) -> size_t {
+        const size_t start = text.find(key);
+        if (start == std::string_view::npos)
+            return 0;
+
+        std::string_view value = text.substr(start + key.size());
+        value.remove_prefix(std::min(value.size(), value.find_first_not_of(' ')));
+
+        size_t kilobytes = 0;
+        std::from_chars(value.data(), value.data() + value.size(), kilobytes);
+        return kilobytes * 1024;
+    };
+
+    swap_total_ = field("\nSwapTotal:");
+    swap_usage_ = swap_total_ - std::min(swap_total_, field("\nSwapFree:"));
+}
+
+auto ProcfsProcessSampler::listProcesses(std::vector<uint32_t>& pids) -> void
+{
+    // Bail out instead of returning an empty tick, that would retire every row in the table.
+    char path[PATH_MAX] = {};
+    snprintf(path, sizeof(path), "%s/proc", source_.root.c_str());
+
+    DIR* proc = opendir(path);
+    if (proc == nullptr)
+        throw std::runtime_error("Failed to open /proc");
+
+    pids.clear();
+    while (dirent* entry = readdir(proc)) {
+        uint32_t pid = 0;
+        const char* name_end = entry->d_name + strlen(entry->d_name);
+        auto [ptr, ec] = std::from_chars(entry->d_name, name_end, pid);
+        if (ec == std::errc() && ptr == name_end)
+            pids.push_back(pid);
+    }
+
+    closedir(proc);
+}
+
+auto ProcfsProcessSampler::readProcess(ProcfsSample& sample, uint32_t metric_groups) -> void
+{
+    ProcfsHandle& handle = *sample.handle;
+
+    // A failed handle is left closed, the caller only has to drop it. A process that exited in the meantime fails in readStat().
+    sample.valid = false;
+    if (sample.opened)
+        openHandle(sample.pid, handle);
+
+    if (!readStat(sample.pid, handle, sample.cpu, sample.faults)) {
+        // The cached descriptor belongs to an exited process, the pid might
+        // have been reused already so try again with fresh descriptors.
+        closeHandle(handle);
+        sample.cpu = {};
+        sample.faults = {};
+        openHandle(sample.pid, handle);
+        if (!readStat(sample.pid, handle, sample.cpu, sample.faults)) {
+            closeHandle(handle);
+            return;
+        }
+    }
+
+    sample.valid = true;
+    if (handle.kernel_thread)
+        return;
+
+    if (handle.cgroup_scan_tick == 0 || tick_ - handle.cgroup_scan_tick >= CgroupRescanTicks)
+        readCgroup(sample.pid, handle);
+
+    if (metric_groups & MetricGroup_Memory) {
+        readStatm(sample.pid, handle, sample.memory_usage);
+        if (swap_usage_ > 0)
+            readSwap(sample.pid, handle, sample.swap_usage);
+    }
+
+    if (metric_groups & MetricGroup_Disk)
+        readIo(sample.pid, handle, sample.io);
+    else
+        handle.io.Reset();  // the first tick after a pause would show the average over the whole pause
+}
+
+auto ProcfsProcessSampler::readSwap(uint32_t pid, ProcfsHandle& handle, size_t& swap_usage) -> void
+{
+    char path[PATH_MAX] = {};
+    char buffer[4096] = {};
+
+    // status is far bigger than stat, it is only kept open for processes seen while the system swaps.
+    snprintf(path, sizeof(path), "%s/proc/%u/status", source_.root.c_str(), pid);
+    if (handle.status_fd < 0)
+        handle.status_fd = openCached(path);
+
+    const ssize_t length = readProcFile(handle.status_fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    // Kernel threads have no VmSwap line.
+    const std::string_view status(buffer, static_cast<size_t>(length));
+    const size_t start = status.find("\nVmSwap:");
+    if (start == std::string_view::npos)
+        return;
+
+    std::string_view value = status.substr(start + 8);
+    value.remove_prefix(std::min(value.size(), value.find_first_not_of(" \t")));
+
+    size_t kilobytes = 0;
+    std::from_chars(value.data(), value.data() + value.size(), kilobytes);
+    swap_usage = kilobytes * 1024;
+}
+
+auto ProcfsProcessSampler::readIo(uint32_t pid, ProcfsHandle& handle, decltype(ProcessInfo::io)& io) -> void
+{
+    if (handle.io_denied)
+        return;
+
+    char path[PATH_MAX] = {};
+    char buffer[512] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/%u/io", source_.root.c_str(), pid);
+    if (handle.io_fd < 0)
+        handle.io_fd = openCached(path);
+
+    // Only readable by the owner, failures are remembered so processes of other users don't cost an open every tick.
+    const ssize_t length = readProcFile(handle.io_fd, path, buffer, sizeof(buffer));
+    if (length <= 0) {
+        closeCached(handle.io_fd);
+        handle.io_denied = true;
+        return;
+    }
+
+    // "rchar: <n>" per line. rchar and wchar include page cache hits, read_bytes and write_bytes are what reached storage.
+    RateCounter<4>::Values counters = {};
+    std::string_view lines(buffer, static_cast<size_t>(length));
+    while (!lines.empty()) {
+        const size_t line_end = std::min(lines.size(), lines.find('\n'));
+        const std::string_view line = lines.substr(0, line_end);
+        lines.remove_prefix(std::min(lines.size(), line_end + 1));
+
+        const size_t colon = line.find(": ");
+        if (colon == std::string_view::npos)
+            continue;
+
+        const std::string_view key = line.substr(0, colon);
+        const size_t index = key == "read_bytes" ? 0 : key == "write_bytes" ? 1 : key == "syscr" ? 2 : key == "syscw" ? 3 : 4;
+        if (index < 4)
+            std::from_chars(line.data() + colon + 2, line.data() + line.size(), counters[index]);
+    }
+
+    if (handle.io.Update(handle.start_time, clockNs(), counters)) {
+        io.read_bytes_per_second = handle.io.Rate(0);
+        io.write_bytes_per_second = handle.io.Rate(1);
+        io.read_calls_per_second = handle.io.Rate(2);
+        io.write_calls_per_second = handle.io.Rate(3);
+    }
+}
+
+auto ProcfsProcessSampler::readDisks(SystemInfo& system) -> void
+{
+    char path[PATH_MAX] = {};
+    char buffer[16384] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/diskstats", source_.root.c_str());
+    if (diskstats_fd_ < 0)
+        diskstats_fd_ = openCached(path);
+
+    const ssize_t length = readProcFile(diskstats_fd_, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    for (ProcfsDiskHandle& disk : disks_)
+        disk.sampled = false;
+
+    const uint64_t now = clockNs();
+
+    std::string_view lines(buffer, static_cast<size_t>(length));
+    while (!lines.empty()) {
+        const size_t line_end = std::min(lines.size(), lines.find('\n'));
+        std::string_view line = lines.substr(0, line_end);
+        lines.remove_prefix(std::min(lines.size(), line_end + 1));
+
+        // "<major> <minor> <name> reads merged sectors ms writes merged sectors ms in_flight io_ms weighted_ms ..."
+        line.remove_prefix(std::min(line.size(), line.find_first_not_of(' ')));
+        uint64_t device[2] = {};
+        if (parseFields(line, device, 2) < 2)
+            continue;
+
+        for (size_t field = 0; field < 2; ++field) {
+            line.remove_prefix(std::min(line.size(), line.find(' ')));
+            line.remove_prefix(std::min(line.size(), line.find_first_not_of(' ')));
+        }
+
+        const std::string_view name = line.substr(0, line.find(' '));
+        line.remove_prefix(name.size());
+
+        uint64_t fields[11] = {};
+        if (name.empty() || parseFields(line, fields, 11) < 11)
+            continue;
+
+        auto disk = std::ranges::find(disks_, name, &ProcfsDiskHandle::name);
+        if (disk == disks_.end()) {
+            // Partitions have no /sys/block entry, virtual devices have no device link.
+            ProcfsDiskHandle added = {};
+            added.name.assign(name);
+            snprintf(path, sizeof(path), "%s/sys/block/%s/device", source_.root.c_str(), added.name.c_str());
+            added.physical = access(path, F_OK) == 0;
+            disk = disks_.insert(disks_.end(), std::move(added));
+        }
+
+        disk->sampled = true;
+        if (!disk->physical)
+            continue;
+
+        const uint64_t requests = fields[0] + fields[4];
+        const uint64_t request_time = fields[3] + fields[7];
+        if (!disk->counters.Update(0, now, { fields[2], fields[6], requests, request_time, fields[9], fields[10] }))
+            continue;
+
+        // diskstats always counts 512 byte sectors, independent of the sector size of the device.
+        // The times are ms per second, 10 of them are 1% busy and 1'000 are one request in flight.
+        const RateCounter<6>& counters = disk->counters;
+        DiskInfo& info = system.disks.emplace_back();
+        info.name = disk->name;
+        info.read_bytes_per_second = counters.Rate(0) * 512.0;
+        info.write_bytes_per_second = counters.Rate(1) * 512.0;
+        info.utilization_percentage = static_cast<float>(std::min(100.0, counters.Rate(4) / 10.0));
+        info.queue_depth = static_cast<float>(counters.Rate(5) / 1'000.0);
+        info.latency_ms = counters.Delta(2) > 0 ? static_cast<float>(static_cast<double>(counters.Delta(3)) / static_cast<double>(counters.Delta(2))) : 0.0f;
+
+        if (info.utilization_percentage > system.disks[system.busiest_disk].utilization_percentage)
+            system.busiest_disk = static_cast<uint32_t>(system.disks.size() - 1);
+    }
+
+    std::erase_if(disks_, [](const ProcfsDiskHandle& disk) { return !disk.sampled; });
+}
+
+auto ProcfsProcessSampler::discoverSensors() -> void
+{
+    sensors_discovered_ = true;
+
+    char path[PATH_MAX] = {};
+    char buffer[512] = {};
+
+    // Attributes are read once here, paths are relative to the root so replays can move it between ticks.
+    auto readAttribute = [&](const std::string& relative) -> std::string_view {
+        snprintf(path, sizeof(path), "%s%s", source_.root.c_str(), relative.c_str());
+        ssize_t length = readProcFile(-1, path, buffer, sizeof(buffer));
+        while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\0'))
+            --length;
+        return length > 0 ? std::string_view(buffer, static_cast<size_t>(length)) : std::string_view{};
+    };
+
+    auto readNumber = [&](const std::string& relative) -> int64_t {
+        const std::string_view value = readAttribute(relative);
+        int64_t number = 0;
+        std::from_chars(value.data(), value.data() + value.size(), number);
+        return number;
+    };
+
+    auto exists = [&](const std::string& relative) -> bool {
+        snprintf(path, sizeof(path), "%s%s", source_.root.c_str(), relative.c_str());
+        return access(path, R_OK) == 0;
+    };
+
+    auto sensor = [](std::string relative, int64_t limit) -> ProcfsSensor {
+        return { .path = std::move(relative), .fd = -1, .limit = limit };
+    };
+
+    snprintf(path, sizeof(path), "%s/sys/class/hwmon", source_.root.c_str());
+    if (DIR* hwmon = opendir(path)) {
+        while (dirent* entry = readdir(hwmon)) {
+            if (!std::string_view(entry->d_name).starts_with("hwmon"))
+                continue;
+
+            const std::string base = std::string("/sys/class/hwmon/") + entry->d_name;
+            const std::string chip(readAttribute(base + "/name"));
+            const bool cpu_chip = chip == "coretemp" || chip == "k10temp" || chip == "zenpower" || chip == "cpu_thermal";
+            const bool gpu_chip = chip == "amdgpu";
+
+            ProcfsSensor edge = sensor({}, 0);
+            ProcfsSensor junction = sensor({}, 0);
+
+            // Numbering has gaps, coretemp starts its cores at the id of the first core plus two.
+            for (uint32_t index = 1; index <= 32 && (cpu_chip || gpu_chip); ++index) {
+                const std::string prefix = base + "/temp" + std::to_string(index);
+                if (!exists(prefix + "_input"))
+                    continue;
+
+                const std::string label(readAttribute(prefix + "_label"));
+                int64_t limit = readNumber(prefix + "_crit");
+                if (limit <= 0)
+                    limit = readNumber(prefix + "_max");
+
+                if (cpu_chip && (cpu_temperature_.path.empty() || label == "Package id 0" || label == "Tctl"))
+                    cpu_temperature_ = sensor(prefix + "_input", limit > 0 ? limit : CpuFallbackThermalLimit);
+                else if (gpu_chip && label == "edge")
+                    edge = sensor(prefix + "_input", limit);
+                else if (gpu_chip && label == "junction")
+                    junction = sensor(prefix + "_input", limit);
+            }
+
+            // APUs report an edge temperature only, a discrete card with a junction sensor wins over them.
+            if (gpu_chip && gpu_hotspot_temperature_.path.empty() && (!junction.path.empty() || gpu_temperature_.path.empty())) {
+                gpu_temperature_ = std::move(edge);
+                gpu_hotspot_temperature_ = std::move(junction);
+                gpu_clock_ = sensor(exists(base + "/freq1_input") ? base + "/freq1_input" : std::string{}, 0);
+
+                // "<level>: <clock>Mhz" per DPM level, the highest level comes last.
+                const std::string_view levels = readAttribute(base + "/device/pp_dpm_sclk");
+                const size_t last = levels.rfind(':');
+                if (last != std::string_view::npos) {
+                    std::string_view clock = levels.substr(last + 1);
+                    clock.remove_prefix(std::min(clock.size(), clock.find_first_not_of(' ')));
+                    std::from_chars(clock.data(), clock.data() + clock.size(), gpu_max_clock_mhz_);
+                }
+            }
+
+            for (uint32_t index = 1; index <= 8; ++index) {
+                const std::string input = base + "/fan" + std::to_string(index) + "_input";
+                if (exists(input))
+                    fans_.push_back(sensor(input, 0));
+            }
+        }
+        closedir(hwmon);
+    }
+
+    // Without a hwmon driver for the CPU the package temperature may still be exposed as a thermal zone.
+    snprintf(path, sizeof(path), "%s/sys/class/thermal", source_.root.c_str());
+    DIR* thermal = cpu_temperature_.path.empty() ? opendir(path) : nullptr;
+    if (thermal != nullptr) {
+        while (dirent* entry = readdir(thermal)) {
+            const std::string base = std::string("/sys/class/thermal/") + entry->d_name;
+            if (std::string_view(entry->d_name).starts_with("thermal_zone") && readAttribute(base + "/type") == "x86_pkg_temp") {
+                cpu_temperature_ = sensor(base + "/temp", CpuFallbackThermalLimit);
+                break;
+            }
+        }
+        closedir(thermal);
+    }
+
+    const std::string throttle_count = "/sys/devices/system/cpu/cpu0/thermal_throttle/package_throttle_count";
+    if (exists(throttle_count)) {
+        cpu_throttle_count_ = sensor(throttle_count, 0);
+        cpu_throttle_events_ = static_cast<uint64_t>(readNumber(throttle_count));
+    }
+
+    cpu_max_clock_mhz_ = static_cast<uint32_t>(readNumber("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq") / 1000);
+}
+
+auto ProcfsProcessSampler::readSensor(ProcfsSensor& sensor, int64_t& value) -> bool
+{
+    if (sensor.path.empty())
+        return false;
+
+    char path[PATH_MAX] = {};
+    snprintf(path, sizeof(path), "%s%s", source_.root.c_str(), sensor.path.c_str());
+    if (sensor.fd < 0)
+        sensor.fd = openCached(path);
+
+    char buffer[32] = {};
+    const ssize_t length = readProcFile(sensor.fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return false;
+
+    return std::from_chars(buffer, buffer + length, value).ec == std::errc();
+}
+
+auto ProcfsProcessSampler::readThermal(SystemInfo& system) -> void
+{
+    if (!sensors_discovered_)
+        discoverSensors();
+
+    ThermalInfo& thermal = system.thermal;
+    int64_t value = 0;
+
+    // Temperatures are in millidegrees Celsius, clocks in Hz.
+    if (readSensor(cpu_temperature_, value)) {
+        thermal.cpu_temperature = static_cast<float>(value) / 1000.0f;
+        thermal.cpu_throttled = value >= cpu_temperature_.limit - ThermalLimitMargin;
+        system.has_thermal = true;
+    }
+
+    if (readSensor(cpu_throttle_count_, value)) {
+        thermal.cpu_throttled |= static_cast<uint64_t>(value) > cpu_throttle_events_;
+        cpu_throttle_events_ = static_cast<uint64_t>(value);
+    }
+
+    if (readSensor(gpu_temperature_, value)) {
+        thermal.gpu_temperature = static_cast<float>(value) / 1000.0f;
+        thermal.gpu_throttled = gpu_temperature_.limit > 0 && value >= gpu_temperature_.limit - ThermalLimitMargin;
+        system.has_thermal = true;
+    }
+
+    if (readSensor(gpu_hotspot_temperature_, value)) {
+        thermal.gpu_hotspot_temperature = static_cast<float>(value) / 1000.0f;
+        thermal.gpu_throttled |= gpu_hotspot_temperature_.limit > 0 && value >= gpu_hotspot_temperature_.limit - ThermalLimitMargin;
+        system.has_thermal = true;
+    }
+
+    if (readSensor(gpu_clock_, value))
+        thermal.gpu_clock_mhz = static_cast<uint32_t>(value / 1'000'000);
+
+    for (ProcfsSensor& fan : fans_) {
+        if (readSensor(fan, value))
+            thermal.fan_rpm = std::max(thermal.fan_rpm, static_cast<uint32_t>(value));
+    }
+
+    for (const CpuCoreInfo& core : system.cores)
+        thermal.cpu_clock_mhz = std::max(thermal.cpu_clock_mhz, core.frequency_mhz);
+
+    thermal.cpu_max_clock_mhz = cpu_max_clock_mhz_;
+    thermal.gpu_max_clock_mhz = gpu_max_clock_mhz_;
+}
+
+auto ProcfsProcessSampler::openHandle(uint32_t pid, ProcfsHandle& handle) -> void
+{
+    char path[PATH_MAX] = {};
+
+    handle = {};
+    handle.status_fd = -1;
+    handle.io_fd = -1;
+
+    snprintf(path, sizeof(path), "%s/proc/%u/stat", source_.root.c_str(), pid);
+    handle.stat_fd = openCached(path);
+    snprintf(path, sizeof(path), "%s/proc/%u/statm", source_.root.c_str(), pid);
+    handle.statm_fd = openCached(path);
+}
+
+auto ProcfsProcessSampler::closeHandle(ProcfsHandle& handle) -> void
+{
+    closeCached(handle.stat_fd);
+    closeCached(handle.statm_fd);
+    closeCached(handle.status_fd);
+    closeCached(handle.io_fd);
+}
+
+auto ProcfsProcessSampler::openThreadHandle(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle) -> bool
+{
+    char path[PATH_MAX] = {};
+
+    handle = {};
+    handle.has_schedstat = true;
+
+    // An exited thread is noticed by the first readThread().
+    snprintf(path, sizeof(path), "%s/proc/%u/task/%u/stat", source_.root.c_str(), pid, tid);
+    handle.stat_fd = openCached(path);
+
+    // Missing without CONFIG_SCHED_INFO, readThread() falls back to the jiffies from stat.
+    snprintf(path, sizeof(path), "%s/proc/%u/task/%u/schedstat", source_.root.c_str(), pid, tid);
+    handle.schedstat_fd = openCached(path);
+
+    return true;
+}
+
+auto ProcfsProcessSampler::closeThreadHandle(ProcfsThreadHandle& handle) -> void
+{
+    closeCached(handle.stat_fd);
+    closeCached(handle.schedstat_fd);
+}
+
+auto ProcfsProcessSampler::openCached(const char* path) -> int
+{
+    // Shared by the sampling and the focus thread.
+    if (cached_descriptors_.fetch_add(1, std::memory_order_relaxed) >= descriptor_limit_) {
+        cached_descriptors_.fetch_sub(1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        cached_descriptors_.fetch_sub(1, std::memory_order_relaxed);
+    return fd;
+}
+
+auto ProcfsProcessSampler::closeCached(int& fd) -> void
+{
+    if (fd >= 0) {
+        close(fd);
+        cached_descriptors_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    fd = -1;
+}
+
+auto ProcfsProcessSampler::readThread(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle, ThreadInfo& thread) -> bool
+{
+    char path[PATH_MAX] = {};
+    char buffer[1024] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/%u/task/%u/stat", source_.root.c_str(), pid, tid);
+    ssize_t length = readProcFile(handle.stat_fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return false;
+
+    // Threads are renamed at any time (pthread_setname_np), so the name is taken from stat every sample.
+    std::string_view stat(buffer, static_cast<size_t>(length));
+    const size_t comm_start = stat.find('(');
+    const size_t comm_end = stat.rfind(')');
+    if (comm_start == std::string_view::npos || comm_end == std::string_view::npos || comm_end + 2 >= stat.size())
+        return false;
+
+    const char state = stat[comm_end + 2];
+
+    uint64_t fields[20] = {};
+    if (parseFields(stat.substr(comm_end + 1), fields, 20) < 20)
+        return false;
+
+    const uint64_t start_time = fields[19];
+    uint64_t cpu_time = (fields[11] + fields[12]) * 1'000'000'000ull / static_cast<uint64_t>(clock_ticks_);
+    uint64_t wait_time = 0;
+
+    // schedstat has the time spent on a CPU and waiting in the run queue in ns, jiffies are too coarse for the focus interval.
+    if (handle.has_schedstat) {
+        char schedstat[128] = {};
+        uint64_t times[2] = {};
+        snprintf(path, sizeof(path), "%s/proc/%u/task/%u/schedstat", source_.root.c_str(), pid, tid);
+        length = readProcFile(handle.schedstat_fd, path, schedstat, sizeof(schedstat));
+        if (length > 0 && parseFields(std::string_view(schedstat, static_cast<size_t>(length)), times, 2) == 2) {
+            cpu_time = times[0];
+            wait_time = times[1];
+        }
+        else {
+            handle.has_schedstat = false;
+        }
+    }
+
+    const uint64_t now = clockNs();
+    const ThreadState current = state == 'R' ? ThreadState_Running : state == 'D' ? ThreadState_IoWait : ThreadState_Sleeping;
+
+    if (handle.start_time != start_time) {
+        handle.start_time = start_time;
+        handle.switches = {};
+        for (int i = 0; i < ThreadState_Count; ++i)
+            handle.state_fractions[i] = i == current ? 1.0f : 0.0f;
+    }
+    else {
+        for (int i = 0; i < ThreadState_Count; ++i)
+            handle.state_fractions[i] += ThreadStateSmoothing * ((i == current ? 1.0f : 0.0f) - handle.state_fractions[i]);
+    }
+
+    // ns per second, 10'000'000 of them are 1%.
+    handle.times.Update(start_time, now, { cpu_time, wait_time });
+
+    thread.tid = tid;
+    thread.name.assign(stat.substr(comm_start + 1, comm_end - comm_start - 1));
+    thread.cpu_usage = handle.times.Rate(0) / 10'000'000.0;
+    std::copy(std::begin(handle.state_fractions), std::end(handle.state_fractions), thread.state_fractions);
+    thread.wait_percentage = handle.times.Rate(1) / 10'000'000.0;
+
+    if (!handle.switches.HasBaseline() || now - handle.switches.Timestamp() >= ContextSwitchIntervalNs)
+        readContextSwitches(pid, tid, handle, now);
+
+    // The rates of the last status read are repeated until the next one.
+    thread.voluntary_switches = handle.switches.Rate(0);
+    thread.involuntary_switches = handle.switches.Rate(1);
+
+    return true;
+}
+
+auto ProcfsProcessSampler::readContextSwitches(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle, uint64_t now) -> void
+{
+    char path[PATH_MAX] = {};
+    char buffer[4096] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/%u/task/%u/status", source_.root.c_str(), pid, tid);
+    const ssize_t length = readProcFile(-1, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    // The two counters are the last lines of status.
+    const std::string_view status(buffer, static_cast<size_t>(length));
+    auto counter = [&status](std::string_view key) -> uint64_t {
+        const size_t start = status.find(key);
+        if (start == std::string_view::npos)
+            return 0;
+
+        std::string_view value = status.substr(start + key.size());
+        value.remove_prefix(std::min(value.size(), value.find_first_not_of(" \t")));
+
+        uint64_t count = 0;
+        std::from_chars(value.data(), value.data() + value.size(), count);
+        return count;
+    };
+
+    handle.switches.Update(handle.start_time, now, { counter("\nvoluntary_ctxt_switches:"), counter("\nnonvoluntary_ctxt_switches:") });
+}
+
+auto ProcfsProcessSampler::readStat(uint32_t pid, ProcfsHandle& handle, decltype(ProcessInfo::cpu)& cpu, decltype(ProcessInfo::faults)& faults) -> bool
+{
+    char path[PATH_MAX] = {};
+    char buffer[1024] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/%u/stat", source_.root.c_str(), pid);
+    ssize_t length = readProcFile(handle.stat_fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return false;
+
+    // comm may contain spaces and parentheses, the fields start after the last ')'.
+    std::string_view stat(buffer, static_cast<size_t>(length));
+    size_t comm_start = stat.find('(');
+    size_t comm_end = stat.rfind(')');
+    if (comm_start == std::string_view::npos || comm_end == std::string_view::npos || comm_end < comm_start)
+        return false;
+
+    // Compared every tick, execve() renames the process without reopening the pid.
+    const std::string_view comm = stat.substr(comm_start + 1, comm_end - comm_start - 1);
+    if (comm != handle.process_name) {
+        handle.process_name.assign(comm);
+        handle.name_id = 0;
+        handle.cgroup_scan_tick = 0;
+    }
+
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt
+    // utime stime cutime cstime priority nice num_threads itrealvalue starttime
+    uint64_t fields[20] = {};
+    if (parseFields(stat.substr(comm_end + 1), fields, 20) < 20)
+        return false;
+
+    const uint64_t parent_pid = fields[1];
+    const uint64_t flags = fields[6];
+    const uint64_t start_time = fields[19];
+
+    handle.start_time = start_time;
+    handle.kernel_thread = (flags & PF_KTHREAD) != 0;
+    handle.parent_pid = static_cast<uint32_t>(parent_pid);
+
+    // Timed per read, the walk over /proc takes long enough that a timestamp for the whole tick skews the last processes.
+    if (handle.stat.Update(start_time, clockNs(), { fields[11], fields[12], fields[7], fields[9] })) {
+        const double scale = 100.0 / (static_cast<double>(clock_ticks_) * static_cast<double>(processor_count_));
+        cpu.user_cpu_usage = handle.stat.Rate(0) * scale;
+        cpu.kernel_cpu_usage = handle.stat.Rate(1) * scale;
+        cpu.total_cpu_usage = cpu.user_cpu_usage + cpu.kernel_cpu_usage;
+
+        faults.minor_per_second = handle.stat.Rate(2);
+        faults.major_per_second = handle.stat.Rate(3);
+    }
+
+    return true;
+}
+
+auto ProcfsProcessSampler::readStatm(uint32_t pid, ProcfsHandle& handle, size_t& memory_usage) -> bool
+{
+    char path[PATH_MAX] = {};
+    char buffer[256] = {};
+
+    snprintf(path, sizeof(path), "%s/proc/%u/statm", source_.root.c_str(), pid);
+    ssize_t length = readProcFile(handle.statm_fd, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return false;
+
+    // size resident shared text lib data dt
+    uint64_t fields[2] = {};
+    if (parseFields(std::string_view(buffer, static_cast<size_t>(length)), fields, 2) < 2)
+        return false;
+
+    memory_usage = static_cast<size_t>(fields[1]) * static_cast<size_t>(page_size_);
+
+    return true;
+}
+
+auto ProcfsProcessSampler::readCgroup(uint32_t pid, ProcfsHandle& handle) -> void
+{
+    char path[PATH_MAX] = {};
+    char buffer[512] = {};
+
+    handle.cgroup_scan_tick = tick_;
+
+    // Only the unified hierarchy is used, its entry is "0::<path>".
+    snprintf(path, sizeof(path), "%s/proc/%u/cgroup", source_.root.c_str(), pid);
+    ssize_t length = readProcFile(-1, path, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    std::string_view entries(buffer, static_cast<size_t>(length));
+    size_t start = entries.find("0::");
+    if (start == std::string_view::npos || (start != 0 && entries[start - 1] != '\n'))
+        return;
+
+    std::string_view entry = entries.substr(start + 3);
+    entry = entry.substr(0, entry.find('\n'));
+    if (entry != handle.cgroup) {
+        handle.cgroup.assign(entry);
+        handle.name_id = 0;
+    }
+}
+
+auto ProcfsProcessSampler::scanDrmFds(uint32_t pid, ProcfsHandle& handle) -> void
+{
+    char path[PATH_MAX] = {};
+    char target[64] = {};
+
+    handle.drm_fds.clear();
+    handle.drm_scan_tick = tick_;
+
+    // Not readable for processes of other users unless running privileged.
+    snprintf(path, sizeof(path), "%s/proc/%u/fd", source_.root.c_str(), pid);
+    DIR* fds = opendir(path);
+    if (fds == nullptr)
+        return;
+
+    while (dirent* entry = readdir(fds)) {
+        int fd = 0;
+        const char* name_end = entry->d_name + strlen(entry->d_name);
+        auto [ptr, ec] = std::from_chars(entry->d_name, name_end, fd);
+        if (ec != std::errc() || ptr != name_end)
+            continue;
+
+        ssize_t length = readlinkat(dirfd(fds), entry->d_name, target, sizeof(target) - 1);
+        if (length > 0 && std::string_view(target, static_cast<size_t>(length)).starts_with("/dev/dri/"))
+            handle.drm_fds.push_back(fd);
+    }
+
+    closedir(fds);
+}
+
+auto ProcfsProcessSampler::readDrmClients(uint32_t pid, ProcfsHandle& handle, ProcessInfo& info) -> void
+{
+    if (handle.drm_scan_tick == 0 || tick_ - handle.drm_scan_tick >= DrmFdRescanTicks)
+        scanDrmFds(pid, handle);
+
+    char path[PATH_MAX] = {};
+    char buffer[4096] = {};
+    DrmFdinfo fdinfo = {};
+
+    for (auto it = handle.drm_fds.begin(); it != handle.drm_fds.end(); ) {
+        // fdinfo is generated on open, the descriptor can't be kept around like stat.
+        snprintf(path, sizeof(path), "%s/proc/%u/fdinfo/%d", source_.root.c_str(), pid, *it);
+        ssize_t length = readProcFile(-1, path, buffer, sizeof(buffer));
+
+        // The descriptor was closed or reused for something else since the last scan.
+        if (length <= 0 || !ParseDrmFdinfo(std::string_view(buffer, static_cast<size_t>(length)), fdinfo)) {
+            it = handle.drm_fds.erase(it);
+            continue;
+        }
+        ++it;
+
+        // Platform devices don't report a PCI slot, they are the only adapter in practice.
+        const AdapterInfo* adapter = adapters_->FindByBusId(fdinfo.pdev);
+        if (adapter == nullptr && adapters_->Adapters().size() == 1)
+            adapter = &adapters_->Adapters().front();
+        if (adapter == nullptr)
+            continue;
+
+        // Client ids are only unique per device. Duplicated descriptors, including
+        // ones inherited or passed to another process, are accounted to the first one seen.
+        const uint64_t client_key = (static_cast<uint64_t>(adapter->adapter_index) << 48) ^ fdinfo.client_id;
+        auto [client_it, inserted] = drm_clients_.try_emplace(client_key);
+        DrmClientState& client = client_it->second;
+
+        if (!inserted && client.last_seen == tick_)
+            continue;
+
+        // The engine names are the instance, a client whose engine list changed has no comparable baseline.
+        // amdgpu only lists the engines a client used so far, the list grows while it runs.
+        uint64_t layout = fdinfo.engine_count;
+        RateCounter<DrmFdinfo_MaxEngines * 3>::Values counters = {};
+        for (size_t i = 0; i < fdinfo.engine_count; ++i) {
+            layout = layout * 31 + std::hash<std::string_view>{}(fdinfo.engines[i].name);
+            counters[i * 3 + 0] = fdinfo.engines[i].busy_ns;
+            counters[i * 3 + 1] = fdinfo.engines[i].cycles;
+            counters[i * 3 + 2] = fdinfo.engines[i].total_cycles;
+        }
+        const bool has_baseline = client.engines.Update(layout, clockNs(), counters);
+        client.last_seen = tick_;
+
+        GpuInfo& gpu = info.gpus[adapter->adapter_index];
+        gpu.gpu_index = adapter->adapter_index;
+        gpu.adapter_index = adapter->adapter_index;
+        gpu.memory.dedicated_vram_usage += fdinfo.vram_usage;
+        gpu.memory.shared_vram_usage += fdinfo.gtt_usage;
+        gpu.memory.dedicated_available = adapter->dedicated_memory;
+        gpu.memory.shared_available = adapter->shared_memory;
+
+        for (size_t i = 0; i < fdinfo.engine_count; ++i) {
+            const DrmEngineUsage& usage = fdinfo.engines[i];
+
+            float utilization = 0.0f;
+            if (has_baseline) {
+                // Drivers without a usable clock (ie. xe) report busy cycles against total cycles instead of time,
+                // both are summed over every instance of the engine class. busy_ns per second, 10'000'000 of them are 1%.
+                const uint64_t total_cycles = client.engines.Delta(i * 3 + 2);
+                if (usage.has_cycles && total_cycles > 0)
+                    utilization = static_cast<float>(static_cast<double>(client.engines.Delta(i * 3 + 1)) / (static_cast<double>(total_cycles) * usage.capacity) * 100.0);
+                else
+                    utilization = static_cast<float>(client.engines.Rate(i * 3) / (10'000'000.0 * usage.capacity));
+            }
+
+            // Looked up by name, the clients of a process list different engines in a different order.
+            const uint32_t engine_index = drmEngineIndex(usage.name);
+            GpuEngine& engine = gpu.engines[engine_index];
+            engine.engine_index = engine_index;
+            engine.engine_type = DecodeDrmEngineType(usage.name);
+            engine.utilization_percentage = std::min(engine.utilization_percentage + utilization, 100.0f);
+        }
+    }
+}
+
+auto ProcfsProcessSampler::drmEngineIndex(std::string_view name) -> uint32_t
+{
+    // A handful of names per driver, a linear search beats hashing them.
+    if (auto it = std::ranges::find(drm_engine_names_, name); it != drm_engine_names_.end())
+        return static_cast<uint32_t>(it - drm_engine_names_.begin());
+
+    drm_engine_names_.emplace_back(name);
+    return static_cast<uint32_t>(drm_engine_names_.size() - 1);
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <core/AdapterRegistry.hpp>
+#include <core/ProcessSampler.hpp>
+#include <core/RateCounter.hpp>
+#include <core/WorkerPool.hpp>
+#include <core/sampler/DrmAdapterRegistry.hpp>
+#include <core/sampler/DrmFdinfo.hpp>
+#include <core/sampler/ProcfsLifecycle.hpp>
+
+// Where ProcfsProcessSampler reads from, the defaults describe the live system.
+// Replays point root at a captured tick and provide the recorded clock and system values.
+struct ProcfsSource {
+    std::string root;                   // prepended to every /proc and /sys path
+    std::function<uint64_t()> clock;    // monotonic ns, CLOCK_MONOTONIC if empty
+    bool reopen_files;                  // don't keep descriptors open, required if root changes between ticks
+    long clock_ticks;                   // the system values are taken from sysconf() when 0
+    long page_size;
+    long processor_count;
+    size_t system_memory;
+};
+
+// Cached state for a single /proc/<pid> entry, the descriptors are kept open
+// between ticks so each sample costs a pread() instead of an open/read/close.
+struct ProcfsHandle {
+    int stat_fd;
+    int statm_fd;
+    int status_fd;          // only opened once the system swaps, -1 before that
+    int io_fd;              // only opened while Disk is sampled, -1 before that
+    uint64_t start_time;    // jiffies since boot, used to detect pid reuse
+    RateCounter<4> stat;    // user, kernel jiffies, minor, major faults
+    RateCounter<4> io;      // read_bytes, write_bytes, syscr, syscw
+    uint32_t parent_pid;
+    bool kernel_thread;
+    bool sampled;
+    bool io_denied;         // io of processes owned by other users can't be read without CAP_SYS_PTRACE
+    std::string process_name;   // comm field of stat, execve() and prctl(PR_SET_NAME) change it
+    uint32_t name_id;       // process_name and cgroup interned in the table, 0 until the first upsert and after either changed
+    std::string cgroup;     // cgroup v2 path, read again every CgroupRescanTicks and after the name changed
+    uint32_t cgroup_id;
+    uint64_t cgroup_scan_tick;  // tick cgroup was last read, 0 if never
+    uint64_t string_generation;     // StringGeneration() of the table name_id and cgroup_id were interned in
+    std::vector<int> drm_fds;   // descriptors of the process pointing at /dev/dri nodes
+    uint64_t drm_scan_tick;     // tick drm_fds was last rebuilt, 0 if never
+};
+
+// Values read for one pid by a sampling worker. Workers only touch their own
+// slots and handles, the table is updated from the slots in /proc order afterwards.
+struct ProcfsSample {
+    uint32_t pid;
+    ProcfsHandle* handle;
+    bool opened;            // the handle was added this tick and still has to be opened
+    bool valid;             // false if the process exited before it could be read
+    decltype(ProcessInfo::cpu) cpu;
+    decltype(ProcessInfo::faults) faults;
+    decltype(ProcessInfo::io) io;
+    size_t memory_usage;
+    size_t swap_usage;
+};
+
+// Cached state for a /proc/<pid>/task/<tid> entry of the focused process.
+struct ProcfsThreadHandle {
+    int stat_fd;
+    int schedstat_fd;
+    uint64_t start_time;    // jiffies since boot, used to detect tid reuse
+    RateCounter<2> times;   // ns on a CPU, ns runnable but not running (from schedstat)
+    RateCounter<2> switches;    // voluntary, involuntary, only read from status every ContextSwitchIntervalNs
+    float state_fractions[ThreadState_Count];
+    bool has_schedstat;
+    bool sampled;
+};
+
+// Counters of a cpuN line of /proc/stat from the previous tick.
+struct ProcfsCoreHandle {
+    int frequency_fd;       // cpufreq/scaling_cur_freq, -1 if not cached
+    bool has_frequency;     // false on systems without a cpufreq driver (ie. most VMs)
+    bool known;             // the entry was initialized, cores are indexed by their number
+    RateCounter<2> times;   // busy, idle + iowait jiffies
+};
+
+// Counters of a /proc/diskstats line from the previous tick.
+struct ProcfsDiskHandle {
+    std::string name;
+    bool physical;          // /sys/block/<name>/device exists, checked once per name
+    bool sampled;
+    // 512 byte sectors read, written, requests completed, ms spent on them,
+    // ms with requests in flight and ms weighted by the requests in flight.
+    RateCounter<6> counters;
+};
+
+// A hwmon, thermal zone or cpufreq attribute found when the sensors were discovered.
+struct ProcfsSensor {
+    std::string path;       // relative to the root, empty if the sensor doesn't exist
+    int fd;
+    int64_t limit;          // value at which the hardware starts throttling, 0 if unknown
+};
+
+// Cumulative stall time of one /proc/pressure file from the previous tick.
+struct ProcfsPressureHandle {
+    int fd;
+    RateCounter<2> totals;  // some, full in us
+};
+
+// Engine counters of a DRM client from the previous tick. A client is one
+// open of a DRM node and may be shared by several descriptors or processes.
+struct DrmClientState {
+    RateCounter<DrmFdinfo_MaxEngines * 3> engines;  // busy_ns, cycles, total_cycles of each engine
+    uint64_t last_seen;     // tick, the client is only accounted once per tick
+};
+
+class ProcfsProcessSampler : public ProcessSampler {
+public:
+    explicit ProcfsProcessSampler(ProcfsSource source = {});
+
+    // Only takes effect for files opened afterwards, see ProcfsSource::reopen_files.
+    auto SetRoot(std::string root) -> void;
+
+    auto Initialize() -> bool override;
+    auto Destroy() -> void override;
+    auto Sample(ProcessTable& table, uint32_t metric_groups) -> void override;
+    auto SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool override;
+    auto SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool override;
+    auto SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void override;
+    auto SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool override;
+    auto TakeExits(std::vector<ProcessExit>& exits) -> void override;
+private:
+    auto clockNs() const -> uint64_t;
+    auto openHandle(uint32_t pid, ProcfsHandle& handle) -> void;
+    auto closeHandle(ProcfsHandle& handle) -> void;
+    auto readStat(uint32_t pid, ProcfsHandle& handle, decltype(ProcessInfo::cpu)& cpu, decltype(ProcessInfo::faults)& faults) -> bool;
+    auto listProcesses(std::vector<uint32_t>& pids) -> void;
+    auto readProcess(ProcfsSample& sample, uint32_t metric_groups) -> void;
+    auto readStatm(uint32_t pid, ProcfsHandle& handle, size_t& memory_usage) -> bool;
+    auto readSwap(uint32_t pid, ProcfsHandle& handle, size_t& swap_usage) -> void;
+    auto readIo(uint32_t pid, ProcfsHandle& handle, decltype(ProcessInfo::io)& io) -> void;
+    auto readMeminfo() -> void;
+    auto readCgroup(uint32_t pid, ProcfsHandle& handle) -> void;
+    auto scanDrmFds(uint32_t pid, ProcfsHandle& handle) -> void;
+    auto openThreadHandle(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle) -> bool;
+    auto closeThreadHandle(ProcfsThreadHandle& handle) -> void;
+    auto openCached(const char* path) -> int;
+    auto closeCached(int& fd) -> void;
+    auto readThread(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle, ThreadInfo& thread) -> bool;
+    auto readContextSwitches(uint32_t pid, uint32_t tid, ProcfsThreadHandle& handle, uint64_t now) -> void;
+    auto readDrmClients(uint32_t pid, ProcfsHandle& handle, ProcessInfo& info) -> void;
+    auto drmEngineIndex(std::string_view name) -> uint32_t;
+    auto readCores(SystemInfo& system) -> void;
+    auto readCoreFrequency(uint32_t core_index, ProcfsCoreHandle& core) -> uint32_t;
+    auto readPressure(const char* resource, ProcfsPressureHandle& handle, PressureInfo& pressure) -> bool;
+    auto readSmaps(const char* path, MemoryDetail& detail) -> bool;
+    auto readDisks(SystemInfo& system) -> void;
+    auto discoverSensors() -> void;
+    auto readSensor(ProcfsSensor& sensor, int64_t& value) -> bool;
+    auto readThermal(SystemInfo& system) -> void;
+
+    ProcfsSource source_;
+    std::unordered_map<uint32_t, ProcfsHandle> handles_;
+    std::vector<ProcfsSample> samples_;     // only touched by Sample()
+    WorkerPool sample_workers_;
+    std::unique_ptr<ProcfsLifecycle> lifecycle_;    // nullptr when replaying or without process events
+    std::vector<uint32_t> listed_pids_;
+    std::unique_ptr<AdapterRegistry> adapters_;
+    std::unordered_map<uint64_t, DrmClientState> drm_clients_;
+    std::vector<std::string> drm_engine_names_;     // position is GpuEngine::engine_index, kept for the lifetime of the sampler
+    ProcfsHandle focus_handle_;   // only touched by SampleFocus()
+    uint32_t focus_pid_;
+    std::unordered_map<uint32_t, ProcfsThreadHandle> focus_threads_;   // only touched by SampleThreads()
+    std::vector<ThreadInfo> focus_thread_rows_;
+    uint32_t focus_threads_pid_;
+    int system_stat_fd_;                    // only touched by SampleSystem()
+    std::string system_stat_buffer_;
+    std::vector<ProcfsCoreHandle> cores_;
+    ProcfsPressureHandle pressure_[3];      // cpu, memory, io
+    int diskstats_fd_;
+    std::vector<ProcfsDiskHandle> disks_;
+    bool sensors_discovered_;
+    ProcfsSensor cpu_temperature_;
+    ProcfsSensor cpu_throttle_count_;   // thermal_throttle/package_throttle_count, Intel only
+    ProcfsSensor gpu_temperature_;
+    ProcfsSensor gpu_hotspot_temperature_;
+    ProcfsSensor gpu_clock_;
+    std::vector<ProcfsSensor> fans_;
+    uint64_t cpu_throttle_events_;
+    uint32_t cpu_max_clock_mhz_;
+    uint32_t gpu_max_clock_mhz_;
+    int meminfo_fd_;                        // only touched by Sample()
+    size_t swap_total_;
+    size_t swap_usage_;
+    std::string detail_buffer_;             // only touched by SampleMemoryDetail()
+    uint64_t tick_;
+    size_t descriptor_limit_;
+    std::atomic<size_t> cached_descriptors_;
+    long clock_ticks_;
+    long page_size_;
+    long processor_count_;
+    size_t system_memory_;
+};
\ No newline at end of file
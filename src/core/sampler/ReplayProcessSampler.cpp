@@ -0,0 +1,155 @@
+#include "ReplayProcessSampler.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <stdio.h>
+
+ReplayProcessSampler::ReplayProcessSampler(std::string directory)
+{
+    directory_ = std::move(directory);
+    ticks_.clear();
+    sampler_ = nullptr;
+    position_ = 0;
+    clock_ = 0;
+    loop_offset_ = 0;
+}
+
+auto ReplayProcessSampler::Initialize() -> bool
+{
+    ProcfsSource source = {};
+    if (!readManifest(source) || ticks_.empty()) {
+        printf("Failed to read the capture in %s.\n\n", directory_.c_str());
+        return false;
+    }
+
+    // Every tick lives in its own directory, so descriptors can't be kept between ticks.
+    source.root = ticks_.front().root;
+    source.clock = [this] { return clock_; };
+    source.reopen_files = true;
+
+    position_ = 0;
+    clock_ = 0;
+    loop_offset_ = 0;
+
+    sampler_ = std::make_unique<ProcfsProcessSampler>(std::move(source));
+    return sampler_->Initialize();
+}
+
+auto ReplayProcessSampler::Destroy() -> void
+{
+    if (sampler_ != nullptr)
+        sampler_->Destroy();
+
+    sampler_.reset();
+    ticks_.clear();
+}
+
+auto ReplayProcessSampler::Sample(ProcessTable& table, uint32_t metric_groups) -> void
+{
+    if (sampler_ == nullptr)
+        throw std::runtime_error("ReplayProcessSampler is not initialized");
+
+    // Wrapping is deferred to the next tick so SampleSystem() still reads the tick Sample() just replayed.
+    if (position_ == ticks_.size()) {
+        // Counters jump back to the first tick, drop the baselines instead of computing negative rates.
+        position_ = 0;
+        loop_offset_ = clock_ + (ticks_.size() > 1 ? ticks_[1].timestamp - ticks_[0].timestamp : 0);
+
+        sampler_->Destroy();
+        sampler_->SetRoot(ticks_.front().root);
+        sampler_->Initialize();
+    }
+
+    const ReplayTick& tick = ticks_[position_++];
+
+    sampler_->SetRoot(tick.root);
+    clock_ = loop_offset_ + tick.timestamp;
+    sampler_->Sample(table, metric_groups);
+}
+
+auto ReplayProcessSampler::SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void
+{
+    if (sampler_ == nullptr) {
+        system = {};
+        return;
+    }
+
+    sampler_->SampleSystem(system, metric_groups);
+}
+
+auto ReplayProcessSampler::SampleFocus(uint32_t, ProcessInfo&, uint32_t) -> bool
+{
+    return false;
+}
+
+auto ReplayProcessSampler::SampleThreads(uint32_t, std::vector<ThreadInfo>&, size_t, SchedulerInfo&) -> bool
+{
+    return false;
+}
+
+auto ReplayProcessSampler::SampleMemoryDetail(uint32_t, MemoryDetail&) -> bool
+{
+    return false;
+}
+
+auto ReplayProcessSampler::TakeExits(std::vector<ProcessExit>& exits) -> void
+{
+    exits.clear();
+}
+
+auto ReplayProcessSampler::readManifest(ProcfsSource& source) -> bool
+{
+    const std::string path = directory_ + "/manifest";
+
+    FILE* manifest = fopen(path.c_str(), "r");
+    if (manifest == nullptr)
+        return false;
+
+    ticks_.clear();
+
+    // "<key> <value>" per line, ticks are listed in order as "tick <directory> <timestamp>".
+    char line[512] = {};
+    while (fgets(line, sizeof(line), manifest) != nullptr) {
+        std::string_view entry(line);
+        while (!entry.empty() && (entry.back() == '\n' || entry.back() == '\r'))
+            entry.remove_suffix(1);
+
+        const size_t separator = entry.find(' ');
+        if (separator == std::string_view::npos)
+            continue;
+
+        const std::string_view key = entry.substr(0, separator);
+        std::string_view value = entry.substr(separator + 1);
+
+        uint64_t number = 0;
+        auto parse = [&number](std::string_view text) {
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), number);
+            return ec == std::errc() && ptr == text.data() + text.size();
+        };
+
+        if (key == "tick") {
+            const size_t timestamp = value.find(' ');
+            if (timestamp == std::string_view::npos || !parse(value.substr(timestamp + 1)))
+                continue;
+
+            ticks_.push_back({ directory_ + "/" + std::string(value.substr(0, timestamp)), number });
+        }
+        else if (key == "clock_ticks" && parse(value)) {
+            source.clock_ticks = static_cast<long>(number);
+        }
+        else if (key == "page_size" && parse(value)) {
+            source.page_size = static_cast<long>(number);
+        }
+        else if (key == "processors" && parse(value)) {
+            source.processor_count = static_cast<long>(number);
+        }
+        else if (key == "memory" && parse(value)) {
+            source.system_memory = static_cast<size_t>(number);
+        }
+    }
+
+    fclose(manifest);
+
+    return true;
+}
\ No newline at end of file
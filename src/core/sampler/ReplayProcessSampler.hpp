@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <core/ProcessSampler.hpp>
+#include <core/sampler/ProcfsProcessSampler.hpp>
+
+// One tick of a capture, see bench/ProcfsCapture.cpp for the layout.
+struct ReplayTick {
+    std::string root;       // directory holding the proc and sys trees of the tick
+    uint64_t timestamp;     // monotonic ns since the first tick
+};
+
+// Feeds a directory written by procfs_capture back through ProcfsProcessSampler,
+// one captured tick per Sample() call no matter how fast it is called. The
+// recorded timestamps drive the rate computations, so a replay produces the
+// same table on every run and machine. After the last tick it starts over.
+class ReplayProcessSampler : public ProcessSampler {
+public:
+    explicit ReplayProcessSampler(std::string directory);
+
+    [[nodiscard]] auto Ticks() const -> const std::vector<ReplayTick>& { return ticks_; }
+    [[nodiscard]] auto Position() const -> size_t { return ticks_.empty() ? 0 : position_ % ticks_.size(); }
+
+    auto Initialize() -> bool override;
+    auto Destroy() -> void override;
+    auto Sample(ProcessTable& table, uint32_t metric_groups) -> void override;
+    auto SampleSystem(SystemInfo& system, uint32_t metric_groups) -> void override;
+
+    // The focused process isn't captured at its own rate and smaps isn't captured at all, these always fail.
+    auto SampleFocus(uint32_t pid, ProcessInfo& info, uint32_t metric_groups) -> bool override;
+    auto SampleThreads(uint32_t pid, std::vector<ThreadInfo>& threads, size_t count, SchedulerInfo& scheduler) -> bool override;
+    auto SampleMemoryDetail(uint32_t pid, MemoryDetail& detail) -> bool override;
+
+    // Exits aren't captured, the table notices them at the tick a process is missing from.
+    auto TakeExits(std::vector<ProcessExit>& exits) -> void override;
+private:
+    auto readManifest(ProcfsSource& source) -> bool;
+
+    std::string directory_;
+    std::vector<ReplayTick> ticks_;
+    std::unique_ptr<ProcfsProcessSampler> sampler_;
+    size_t position_;
+    uint64_t clock_;
+    uint64_t loop_offset_;  // added to the recorded timestamps so the clock keeps rising across loops
+};
\ No newline at end of file
@@ -5,6 +5,11 @@
 #include <thread>
 #include <math.h>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
 #include <imgui.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <extension/ImGui/backends/imgui_impl_openvr.h>
@@ -24,13 +29,30 @@ static vr::ETrackedControllerRole g_overlay_handedness = vr::TrackedControllerRo
 static glm::vec3 g_position = {};
 static glm::quat g_rotation = {};
 
+// Busy share of the busiest core above which it counts as saturated.
+constexpr float kCoreSaturationPercentage = 95.0f;
+
+// Major faults per second of the game above which paging is highlighted, each one waits on a disk read.
+constexpr double kMajorFaultWarning = 50.0;
+
+// Share of the frame budget the game may spend waiting for a CPU before it is highlighted.
+constexpr float kSchedulerWaitWarning = 0.1f;
+
+// Utilization of the busiest disk above which it counts as saturated, requests queue up behind each other from here on.
+constexpr float kDiskSaturationPercentage = 90.0f;
+
 ControllerOverlay::ControllerOverlay() : Overlay(OVERLAY_KEY, OVERLAY_NAME, vr::VROverlayType_World, OVERLAY_WIDTH, OVERLAY_HEIGHT)
 {
     frame_time_ = {};
     refresh_rate_ = {};
     last_pid = {};
+    game_rollup_ = {};
+    game_rollup_sequence_ = 0;
+    game_rollup_pid_ = 0;
+    metrics_since_ = {};
     cpu_frame_times_ = {};
     gpu_frame_times_ = {};
+    memory_stall_history_ = {};
     tracked_devices_ = {};
     display_mode_ = {};
     overlay_scale_ = {};
@@ -76,8 +98,6 @@ ControllerOverlay::ControllerOverlay() : Overlay(OVERLAY_KEY, OVERLAY_NAME, vr::
 
     ImPlot::CreateContext();
 
-    task_monitor_.Initialize();
-
     settings_.Load();
 
     display_mode_ = static_cast<Overlay_DisplayMode>(settings_.DisplayMode());
@@ -130,20 +150,39 @@ auto ControllerOverlay::Render() -> bool
     ) {
         ImGuiStyle& style = ImGui::GetStyle();
 
-        GpuInfo gpu_info = {};
-		ProcessInfo process_info = {};
+        static const ProcessInfo empty_process = {};
+
+        // The handle keeps the rows alive for the rest of the frame, nothing is copied out of it.
+        ProcessSnapshotHandle snapshot = g_taskMonitor->Snapshot();
 
-        ImGui::Indent(10.0f);
         uint32_t pid = GetCurrentGamePid();
+        const ProcessInfo* game_process = pid > 0 ? snapshot->Find(pid) : nullptr;
+        const ProcessInfo& process_info = game_process != nullptr ? *game_process : empty_process;
+        const GpuInfo& gpu_info = getCurrentlyUsedGpu(process_info);
+
+        // CPU and RAM of the game come from the focused sampler, which runs close to frame rate.
+        g_taskMonitor->SetFocusPid(pid);
+        auto focus = g_taskMonitor->FocusSnapshot();
+        const bool focused = pid > 0 && focus->pid == pid;
+        const auto& cpu_info = focused ? focus->process.cpu : process_info.cpu;
+        const size_t memory_usage = focused ? focus->process.memory_usage : process_info.memory_usage;
+
+        // Launchers, anti-cheat and UI helpers of the game are summed up through the process tree.
+        if (snapshot->sequence != game_rollup_sequence_ || pid != game_rollup_pid_) {
+            game_rollup_ = pid > 0 ? snapshot->Rollup(pid) : ProcessRollup{};
+            game_rollup_sequence_ = snapshot->sequence;
+            game_rollup_pid_ = pid;
+        }
+
+        ImGui::Indent(10.0f);
         if (pid > 0) {
             // TODO: check if last_pid actually exists before doing reset, if game utilizes SteamVR Compositor GetCurrentGamePid might return wrong pid temporarily causing stat reset.
             if (last_pid != pid) {
                 this->Reset();
                 last_pid = pid;
             }
-			process_info = task_monitor_.GetProcessInfoByPid(pid);
-            gpu_info = getCurrentlyUsedGpu(process_info);
-            ImGui::Text("Current Application: %s (%d)", process_info.process_name.c_str(), pid);
+            const std::string_view process_name = snapshot->Name(process_info);
+            ImGui::Text("Current Application: %.*s (%d)", static_cast<int>(process_name.size()), process_name.data(), pid);
         }
         else {
 			ImGui::Text("Current Application: SteamVR Void");
@@ -163,6 +202,24 @@ auto ControllerOverlay::Render() -> bool
                 ImGui::Text("CPU Frametime");
                 ImGui::TableSetColumnIndex(1);
                 ImGui::Text("%.1f ms", cpu_frame_time_sample_);
+
+                // Run-queue delay of all game threads scaled to one frame, time the game was ready but had no CPU.
+                const SchedulerInfo& scheduler = focus->scheduler;
+                if (focused && (scheduler.wait_percentage > 0.0 || scheduler.involuntary_switches > 0.0)) {
+                    const float wait_ms = static_cast<float>(scheduler.wait_percentage / 100.0) * frame_time_;
+
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("CPU Wait");
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::TextColored(
+                        wait_ms >= frame_time_ * kSchedulerWaitWarning ? Color_Orange : Color_Green,
+                        "%.2f ms/frame (%.0f preempt/s)",
+                        wait_ms,
+                        scheduler.involuntary_switches
+                    );
+                }
+
                 ImGui::EndTable();
                 ImGui::Unindent(10.0f);
             }
@@ -193,6 +250,13 @@ auto ControllerOverlay::Render() -> bool
                 static double y_ticks[1] = { frame_time_ };
                 ImPlot::SetupAxisTicks(ImAxis_Y1, y_ticks, 1, nullptr, false);
 
+                // Memory stalls (PSI "some", 0-100 %) share the time axis so spikes can be matched against paging.
+                const bool plot_memory_stall = snapshot->system.has_pressure;
+                if (plot_memory_stall) {
+                    ImPlot::SetupAxis(ImAxis_Y2, nullptr, ImPlotAxisFlags_NoDecorations | ImPlotAxisFlags_NoMenus | ImPlotAxisFlags_NoHighlight | ImPlotAxisFlags_Lock);
+                    ImPlot::SetupAxisLimits(ImAxis_Y2, 0.0, 100.0, ImGuiCond_Always);
+                }
+
                 for (int i = 0; i < static_cast<int>(refresh_rate_) - 1; ++i) {
 
                     ImVec4 color;
@@ -224,6 +288,13 @@ auto ControllerOverlay::Render() -> bool
                     ImPlot::PopStyleColor();
                 }
 
+                if (plot_memory_stall) {
+                    ImPlot::SetAxes(ImAxis_X1, ImAxis_Y2);
+                    ImPlot::PushStyleColor(ImPlotCol_Line, ImGui::ColorConvertFloat4ToU32(Color_Red));
+                    ImPlot::PlotLine("##memory_stall", memory_stall_history_.data(), static_cast<int>(memory_stall_history_.size()), -frame_dt);
+                    ImPlot::PopStyleColor();
+                }
+
                 ImPlot::EndPlot();
             }
 
@@ -310,7 +381,59 @@ auto ControllerOverlay::Render() -> bool
                 ImGui::TableSetColumnIndex(0);
                 ImGui::Text("CPU");
                 ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%.1f %%", process_info.cpu.total_cpu_usage);
+                ImGui::Text("%.1f %%", cpu_info.total_cpu_usage);
+
+                if (!snapshot->system.cores.empty()) {
+                    const SystemInfo& system = snapshot->system;
+                    const auto core = std::ranges::find(system.cores, system.max_core_index, &CpuCoreInfo::core_index);
+                    const ImVec4 color = system.max_core_usage >= kCoreSaturationPercentage ? Color_Orange : Color_Green;
+
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Max Core");
+                    ImGui::TableSetColumnIndex(1);
+                    if (core != system.cores.end() && core->frequency_mhz > 0)
+                        ImGui::TextColored(color, "%.0f %% (#%u, %.2f GHz)", system.max_core_usage, system.max_core_index, core->frequency_mhz / 1000.0f);
+                    else
+                        ImGui::TextColored(color, "%.0f %% (#%u)", system.max_core_usage, system.max_core_index);
+                }
+
+                // Clocks drop before the frame time does, a throttled part looks like a plain CPU or GPU bottleneck otherwise.
+                if (snapshot->system.has_thermal) {
+                    const ThermalInfo& thermal = snapshot->system.thermal;
+                    const ImVec4 color = thermal.cpu_throttled || thermal.gpu_throttled ? Color_Orange : Color_Green;
+
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Thermal");
+                    ImGui::TableSetColumnIndex(1);
+                    if (thermal.gpu_hotspot_temperature > 0.0f)
+                        ImGui::TextColored(color, "CPU %.0f C, GPU %.0f / %.0f C", thermal.cpu_temperature, thermal.gpu_temperature, thermal.gpu_hotspot_temperature);
+                    else
+                        ImGui::TextColored(color, "CPU %.0f C, GPU %.0f C", thermal.cpu_temperature, thermal.gpu_temperature);
+
+                    if (thermal.cpu_max_clock_mhz > 0 || thermal.gpu_max_clock_mhz > 0) {
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::Text("Clocks");
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::Text(
+                            "CPU %u / %u, GPU %u / %u MHz",
+                            thermal.cpu_clock_mhz,
+                            thermal.cpu_max_clock_mhz,
+                            thermal.gpu_clock_mhz,
+                            thermal.gpu_max_clock_mhz
+                        );
+                    }
+
+                    if (thermal.fan_rpm > 0) {
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::Text("Fan");
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::Text("%u RPM", thermal.fan_rpm);
+                    }
+                }
 
                 ImGui::TableNextRow();
                 ImGui::TableSetColumnIndex(0);
@@ -392,17 +515,99 @@ auto ControllerOverlay::Render() -> bool
                 ImGui::TableSetColumnIndex(1);
                 ImGui::Text(
                     "%.0f MB (%.1f%%)",
-                    process_info.memory_usage / (1024.0f * 1024.0f),
+                    memory_usage / (1024.0f * 1024.0f),
                     gpu_info.memory.dedicated_available > 0
-                    ? (process_info.memory_usage * 100.0f) / process_info.memory_available
+                    ? (memory_usage * 100.0f) / process_info.memory_available
                     : 0.0f
                 );
 
+                // Shared libraries and mappings are counted in full by RAM, PSS splits them between their users.
+                auto memory_details = g_taskMonitor->MemoryDetails();
+                if (const MemoryDetail* detail = pid > 0 ? memory_details->Find(pid) : nullptr) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text(detail->pss > 0 ? "PSS / USS" : "USS");
+                    ImGui::TableSetColumnIndex(1);
+                    if (detail->pss > 0)
+                        ImGui::Text("%.0f MB / %.0f MB", detail->pss / (1024.0f * 1024.0f), detail->uss / (1024.0f * 1024.0f));
+                    else
+                        ImGui::Text("%.0f MB", detail->uss / (1024.0f * 1024.0f));
+                }
+
+                // Only shown once the game pages, major faults stall it even while RAM is left.
+                const auto& faults = focused ? focus->process.faults : process_info.faults;
+                if (faults.major_per_second > 0.0 || process_info.swap_usage > 0) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Paging");
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::TextColored(
+                        faults.major_per_second >= kMajorFaultWarning ? Color_Orange : Color_Green,
+                        "%.0f faults/s, %.0f MB swap",
+                        faults.major_per_second,
+                        process_info.swap_usage / (1024.0f * 1024.0f)
+                    );
+                }
+
+                // Only shown while the game touches storage, streaming stalls line up with a saturated disk.
+                if (process_info.io.read_bytes_per_second > 0.0 || process_info.io.write_bytes_per_second > 0.0) {
+                    const SystemInfo& system = snapshot->system;
+                    const DiskInfo* disk = system.disks.empty() ? nullptr : &system.disks[system.busiest_disk];
+
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Disk");
+                    ImGui::TableSetColumnIndex(1);
+                    if (disk != nullptr)
+                        ImGui::TextColored(
+                            disk->utilization_percentage >= kDiskSaturationPercentage ? Color_Orange : Color_Green,
+                            "%.1f / %.1f MB/s (%.0f%%, %.1f ms)",
+                            process_info.io.read_bytes_per_second / (1000.0 * 1000.0),
+                            process_info.io.write_bytes_per_second / (1000.0 * 1000.0),
+                            disk->utilization_percentage,
+                            disk->latency_ms
+                        );
+                    else
+                        ImGui::Text(
+                            "%.1f / %.1f MB/s",
+                            process_info.io.read_bytes_per_second / (1000.0 * 1000.0),
+                            process_info.io.write_bytes_per_second / (1000.0 * 1000.0)
+                        );
+                }
+
+                if (game_rollup_.process_count > 1) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Total (%u)", game_rollup_.process_count);
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text(
+                        "%.1f %% / %.0f MB",
+                        game_rollup_.cpu_usage,
+                        game_rollup_.memory_usage / (1024.0f * 1024.0f)
+                    );
+                }
+
                 ImGui::TableNextRow();
                 ImGui::TableSetColumnIndex(0);
                 ImGui::Text("Bottleneck");
                 ImGui::TableSetColumnIndex(1);
-                ImGui::TextColored(bottleneck_ ? Color_Orange : Color_Green, "%s", bottleneck_ ? (bottleneck_flags_ == BottleneckSource_Flags_Wireless ? "Wireless" : bottleneck_flags_ == BottleneckSource_Flags_CPU ? "CPU" : "GPU") : "None");
+                ImGui::TextColored(bottleneck_ ? Color_Orange : Color_Green, "%s", bottleneck_ ? (bottleneck_flags_ == BottleneckSource_Flags_Wireless ? "Wireless" : bottleneck_flags_ == BottleneckSource_Flags_Thermal ? "Thermal" : bottleneck_flags_ == BottleneckSource_Flags_CPU ? "CPU" : "GPU") : "None");
+
+                // A single saturated thread makes the game CPU bound no matter how many cores are idle.
+                if (focused && !focus->threads.empty()) {
+                    const ThreadInfo& hot_thread = focus->threads.front();
+                    const float* states = hot_thread.state_fractions;
+                    const ImVec4 color = hot_thread.cpu_usage >= 90.0 ? Color_Orange : Color_Green;
+
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("Hot Thread");
+                    ImGui::TableSetColumnIndex(1);
+                    if (states[ThreadState_Running] + states[ThreadState_Sleeping] + states[ThreadState_IoWait] > 0.0f)
+                        ImGui::TextColored(color, "%s %.0f %% (run %.0f%%, io %.0f%%)", hot_thread.name.c_str(), hot_thread.cpu_usage, states[ThreadState_Running] * 100.0f, states[ThreadState_IoWait] * 100.0f);
+                    else
+                        ImGui::TextColored(color, "%s %.0f %%", hot_thread.name.c_str(), hot_thread.cpu_usage);
+                }
 
                 ImGui::Unindent(10.0f);
 
@@ -808,6 +1013,14 @@ auto ControllerOverlay::Update() -> void
         info_gpu.frametime = gpu_frame_time_ms_;
         gpu_frame_times_.data()[frame_index_] = info_gpu;
 
+        // Sampling is suspended while the overlay is hidden, the last snapshot stays readable but goes stale.
+        // Its system state only counts once a tick ran after the overlay was shown, until then nothing is saturated.
+        static const SystemInfo no_system = {};
+        const ProcessSnapshotHandle snapshot = g_taskMonitor->Snapshot();
+        const bool current = this->IsVisible() && snapshot->timestamp >= metrics_since_;
+        const SystemInfo& system = current ? snapshot->system : no_system;
+        memory_stall_history_[frame_index_] = system.memory_pressure.some_percentage;
+
         total_predicted_frames_ += predicted_frames;
         total_dropped_frames_ += timings.m_nNumDroppedFrames;
         total_throttled_frames_ += throttled_frames;
@@ -832,13 +1045,22 @@ auto ControllerOverlay::Update() -> void
         constexpr int kTriggerThreshold = 5;
         constexpr int kClearThreshold = 10;
 
+        // A pinned core with an over-budget CPU frame is CPU bound even when the compositor reports no stall,
+        // the per-process average spreads a saturated render thread over every core.
+        const bool core_saturated = system.max_core_usage >= kCoreSaturationPercentage;
+
+        // Checked before CPU and GPU, a throttled part misses its frames for a reason more headroom on the settings won't fix.
+        const bool throttled = system.thermal.cpu_throttled || system.thermal.gpu_throttled;
+
         BottleneckSource_Flags detected_flags = BottleneckSource_Flags_None;
         if (wireless_latency_ >= 15.0f)
             detected_flags = BottleneckSource_Flags_Wireless;
+        else if (throttled && static_cast<int>(current_fps_) != static_cast<int>(refresh_rate_))
+            detected_flags = BottleneckSource_Flags_Thermal;
         else if ((gpu_frame_times_[frame_index_].flags & FrameTimeInfo_Flags_Reprojecting || gpu_frame_times_[frame_index_].flags & FrameTimeInfo_Flags_OneThirdFramePresented) &&
             static_cast<int>(current_fps_) != static_cast<int>(refresh_rate_))
             detected_flags = BottleneckSource_Flags_GPU;
-        else if ((cpu_frame_times_[frame_index_].flags & FrameTimeInfo_Flags_Frame_Cpu_Stalled) &&
+        else if ((cpu_frame_times_[frame_index_].flags & FrameTimeInfo_Flags_Frame_Cpu_Stalled || (core_saturated && cpu_frame_time_ms_ > frame_time_)) &&
             static_cast<int>(current_fps_) != static_cast<int>(refresh_rate_))
             detected_flags = BottleneckSource_Flags_CPU;
 
@@ -878,7 +1100,6 @@ auto ControllerOverlay::Update() -> void
     if (ImGui::GetTime() - last_time >= 0.5f) {
 		cpu_frame_time_sample_ = cpu_frame_time_ms_;
 		gpu_frame_time_avg_ = gpu_frame_time_ms_;
-        task_monitor_.Update();
         float effective_frametime_ms = std::max(
             frame_time_,
             timings.m_flCompositorRenderCpuMs +
@@ -908,6 +1129,17 @@ auto ControllerOverlay::Update() -> void
         }
     }
 
+    // Sampling is suspended while no overlay showing its results is visible, Render() refocuses on the next visible frame.
+    const bool visible = this->IsVisible();
+    if (visible && metrics_subscription_.MetricGroups() == MetricGroup_None)
+        metrics_since_ = std::chrono::steady_clock::now();
+
+    // Every group is drawn, cores and thermal also feed the bottleneck detection above.
+    constexpr uint32_t rendered_groups = MetricGroup_Cpu | MetricGroup_Memory | MetricGroup_Gpu | MetricGroup_Disk | MetricGroup_Thermal | MetricGroup_Cores;
+    metrics_subscription_.Update(visible ? rendered_groups : MetricGroup_None);
+    if (!visible)
+        g_taskMonitor->SetFocusPid(0);
+
     const auto scale = this->OverlayScale();
     if (g_overlay_width != scale) {
         this->SetWidth(scale);
@@ -937,7 +1169,8 @@ auto ControllerOverlay::Destroy() -> void
     delete[] colour_mask_;
     colour_mask_ = nullptr;
 
-    task_monitor_.Destroy();
+    g_taskMonitor->SetFocusPid(0);
+    metrics_subscription_.Update(MetricGroup_None);
 
     ImPlot::DestroyContext();
 }
@@ -949,6 +1182,7 @@ auto ControllerOverlay::Reset() -> void
 
     memset(cpu_frame_times_.data(), 0x0, cpu_frame_times_.size() * sizeof(FrameTimeInfo));
     memset(gpu_frame_times_.data(), 0x0, cpu_frame_times_.size() * sizeof(FrameTimeInfo));
+    memory_stall_history_.assign(static_cast<int>(refresh_rate_), 0.0f);
 
     frame_index_ = 0;
 
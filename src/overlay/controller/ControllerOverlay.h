@@ -23,7 +23,8 @@ enum BottleneckSource_Flags : uint32_t {
     BottleneckSource_Flags_None = 0,
     BottleneckSource_Flags_CPU = 1 << 0,
     BottleneckSource_Flags_GPU = 1 << 1,
-    BottleneckSource_Flags_Wireless = 1 << 2
+    BottleneckSource_Flags_Wireless = 1 << 2,
+    BottleneckSource_Flags_Thermal = 1 << 3
 };
 
 struct alignas(8) FrameTimeInfo
@@ -71,7 +72,6 @@ public:
 private:
     auto UpdateDeviceTransform() -> void;
 
-    TaskMonitor task_monitor_;
     Settings settings_;
 
     float frame_time_;
@@ -103,8 +103,14 @@ private:
     uint32_t bottleneck_flags_;
     bool bottleneck_;
     float wireless_latency_;
+    ProcessRollup game_rollup_;     // game and its child processes, refreshed once per snapshot
+    uint64_t game_rollup_sequence_;
+    uint32_t game_rollup_pid_;
+    MetricSubscription metrics_subscription_;   // only held while the overlay is shown
+    std::chrono::steady_clock::time_point metrics_since_;     // when the overlay was last shown, older snapshots are stale
     std::vector<FrameTimeInfo> cpu_frame_times_;
     std::vector<FrameTimeInfo> gpu_frame_times_;
+    std::vector<float> memory_stall_history_;   // PSI memory "some" % per frame, indexed like the frame times
     std::vector<TrackedDevice> tracked_devices_;
 
     bool color_temperature_;
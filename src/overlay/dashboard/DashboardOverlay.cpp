@@ -1,10 +1,16 @@
 #include "DashboardOverlay.h"
 
 #include <algorithm>
-#include <chrono>
+#include <numeric>
 
 #include <SDL3/SDL.h>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <signal.h>
+#endif
+
 #include <imgui.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <extension/ImGui/backends/imgui_impl_openvr.h>
@@ -16,18 +22,15 @@
 #define OVERLAY_WIDTH   1600
 #define OVERLAY_HEIGHT  900
 
-struct CachedProcessRow
-{
-    uint32_t    pid;
-    ProcessInfo info;
-    GpuInfo     gpu;
-};
-
-static std::vector<CachedProcessRow> g_cached_rows;
+// Row indices into the columns of g_snapshot in display order.
+static std::vector<uint32_t> g_row_order;
+static ProcessSnapshotHandle g_snapshot = nullptr;
 static bool g_rows_dirty = true;
 static ImGuiTableSortSpecs g_cached_sort = {};
-static std::chrono::steady_clock::time_point g_last_update;
 
+// Clicked row, its PSS/USS is sampled by the TaskMonitor detail thread while the dashboard is shown.
+static uint32_t g_selected_pid = 0;
+static std::shared_ptr<const MemoryDetailSnapshot> g_memory_details = nullptr;
 
 DashboardOverlay::DashboardOverlay() : Overlay(OVERLAY_KEY, OVERLAY_NAME, vr::VROverlayType_Dashboard, OVERLAY_WIDTH, OVERLAY_HEIGHT)
 {
@@ -53,13 +56,9 @@ DashboardOverlay::DashboardOverlay() : Overlay(OVERLAY_KEY, OVERLAY_NAME, vr::VR
         std::exit(EXIT_FAILURE);
     }
 
-    task_monitor_.Initialize();
-
     ImGuiStyle& style = ImGui::GetStyle();
     style.ScaleAllSizes(2.0f);
     style.FontScaleDpi = 2.0f;
-
-    g_last_update = std::chrono::steady_clock::now();
 }
 
 auto DashboardOverlay::Render()-> bool
@@ -67,6 +66,10 @@ auto DashboardOverlay::Render()-> bool
     if (!Overlay::Render())
         return false;
 
+    // Nothing to draw while another dashboard tab is selected or the dashboard is closed.
+    if (!this->IsVisible())
+        return false;
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplOpenVR_NewFrame();
     ImGui::NewFrame();
@@ -93,7 +96,7 @@ auto DashboardOverlay::Render()-> bool
         ImGuiTableFlags_SizingStretchProp |
         ImGuiTableFlags_Sortable;
 
-    if (ImGui::BeginTable("process_list", 9, flags))
+    if (ImGui::BeginTable("process_list", 11, flags))
     {
         ImGui::TableSetupColumn("PID");
         ImGui::TableSetupColumn("Name");
@@ -103,6 +106,8 @@ auto DashboardOverlay::Render()-> bool
         ImGui::TableSetupColumn("D-VRAM");
         ImGui::TableSetupColumn("S-VRAM");
         ImGui::TableSetupColumn("RAM");
+        ImGui::TableSetupColumn("Disk Read");
+        ImGui::TableSetupColumn("Disk Write");
         ImGui::TableSetupColumn("Actions");
         ImGui::TableHeadersRow();
 
@@ -115,67 +120,35 @@ auto DashboardOverlay::Render()-> bool
 
         if (g_rows_dirty || sort_changed)
         {
-            g_cached_rows.clear();
-            g_cached_rows.reserve(task_monitor_.Processes().size());
-
-            for (auto& [pid, info] : task_monitor_.Processes())
-            {
-                g_cached_rows.push_back({
-                    pid,
-                    info,
-                    getCurrentlyUsedGpu(info)
-                    });
-            }
+            const ProcessColumns& columns = g_snapshot->columns;
 
             if (sort_specs && sort_specs->SpecsCount > 0)
             {
                 const auto& s = sort_specs->Specs[0];
+                const bool ascending = s.SortDirection == ImGuiSortDirection_Ascending;
 
-                std::sort(g_cached_rows.begin(), g_cached_rows.end(),
-                    [&](const CachedProcessRow& a,
-                        const CachedProcessRow& b)
-                    {
-                        switch (s.ColumnIndex)
-                        {
-                        case 0: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.pid < b.pid : a.pid > b.pid;
-
-                        case 1: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.info.process_name < b.info.process_name
-                            : a.info.process_name > b.info.process_name;
-
-                        case 2: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.info.cpu.total_cpu_usage < b.info.cpu.total_cpu_usage
-                            : a.info.cpu.total_cpu_usage > b.info.cpu.total_cpu_usage;
-
-                        case 3: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? gpuPercentage(a.gpu) < gpuPercentage(b.gpu)
-                            : gpuPercentage(a.gpu) > gpuPercentage(b.gpu);
-
-                        case 4: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? gpuVideoPercentage(a.gpu) < gpuVideoPercentage(b.gpu)
-                            : gpuVideoPercentage(a.gpu) > gpuVideoPercentage(b.gpu);
-
-                        case 5: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.gpu.memory.dedicated_vram_usage <
-                            b.gpu.memory.dedicated_vram_usage
-                            : a.gpu.memory.dedicated_vram_usage >
-                            b.gpu.memory.dedicated_vram_usage;
-
-                        case 6: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.gpu.memory.shared_vram_usage <
-                            b.gpu.memory.shared_vram_usage
-                            : a.gpu.memory.shared_vram_usage >
-                            b.gpu.memory.shared_vram_usage;
-
-                        case 7: return s.SortDirection == ImGuiSortDirection_Ascending
-                            ? a.info.memory_usage <
-                            b.info.memory_usage
-                            : a.info.memory_usage >
-                            b.info.memory_usage;
-                        }
-                        return false;
-                    });
+                switch (s.ColumnIndex)
+                {
+                case 0: SortByColumn(columns.pid, ascending, g_row_order); break;
+                case 1: SortByColumn(columns.name, ascending, g_row_order); break;
+                case 2: SortByColumn(columns.cpu_usage, ascending, g_row_order); break;
+                case 3: SortByColumn(columns.gpu_usage, ascending, g_row_order); break;
+                case 4: SortByColumn(columns.video_usage, ascending, g_row_order); break;
+                case 5: SortByColumn(columns.dedicated_vram_usage, ascending, g_row_order); break;
+                case 6: SortByColumn(columns.shared_vram_usage, ascending, g_row_order); break;
+                case 7: SortByColumn(columns.memory_usage, ascending, g_row_order); break;
+                case 8: SortByColumn(columns.disk_read_usage, ascending, g_row_order); break;
+                case 9: SortByColumn(columns.disk_write_usage, ascending, g_row_order); break;
+                default:
+                    g_row_order.resize(columns.Size());
+                    std::iota(g_row_order.begin(), g_row_order.end(), 0u);
+                    break;
+                }
+            }
+            else
+            {
+                g_row_order.resize(columns.Size());
+                std::iota(g_row_order.begin(), g_row_order.end(), 0u);
             }
 
             if (sort_specs)
@@ -184,47 +157,79 @@ auto DashboardOverlay::Render()-> bool
             g_rows_dirty = false;
         }
 
-        for (auto& row : g_cached_rows)
+        const ProcessColumns& columns = g_snapshot->columns;
+
+        for (uint32_t row : g_row_order)
         {
             ImGui::TableNextRow();
 
             ImGui::TableSetColumnIndex(0);
-            ImGui::Text("%llu", row.pid);
+            ImGui::Text("%u", columns.pid[row]);
 
             ImGui::TableSetColumnIndex(1);
-            ImGui::Text("%s", row.info.process_name.c_str());
+            const std::string_view name = columns.Name(row);
+            const bool selected = columns.pid[row] == g_selected_pid;
+            ImGui::PushID(columns.pid[row]);
+            if (ImGui::Selectable("##select", selected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap))
+                g_selected_pid = selected ? 0 : columns.pid[row];
+            ImGui::PopID();
+            ImGui::SameLine();
+            ImGui::TextUnformatted(name.data(), name.data() + name.size());
 
             ImGui::TableSetColumnIndex(2);
-            ImGui::Text("%.1f %%", row.info.cpu.total_cpu_usage);
+            ImGui::Text("%.1f %%", columns.cpu_usage[row]);
 
             ImGui::TableSetColumnIndex(3);
-            ImGui::Text("%.1f %%", gpuPercentage(row.gpu));
+            ImGui::Text("%.1f %%", columns.gpu_usage[row]);
 
             ImGui::TableSetColumnIndex(4);
-            ImGui::Text("%.1f %%", gpuVideoPercentage(row.gpu));
+            ImGui::Text("%.1f %%", columns.video_usage[row]);
 
             ImGui::TableSetColumnIndex(5);
             ImGui::Text("%.0f MB",
-                row.gpu.memory.dedicated_vram_usage / (1000.0f * 1000.0f));
+                columns.dedicated_vram_usage[row] / (1000.0f * 1000.0f));
 
             ImGui::TableSetColumnIndex(6);
             ImGui::Text("%.0f MB",
-                row.gpu.memory.shared_vram_usage / (1000.0f * 1000.0f));
+                columns.shared_vram_usage[row] / (1000.0f * 1000.0f));
 
             ImGui::TableSetColumnIndex(7);
-            ImGui::Text("%.0f MB",
-                row.info.memory_usage / (1024.0f * 1024.0f));
+            const MemoryDetail* detail = selected && g_memory_details ? g_memory_details->Find(columns.pid[row]) : nullptr;
+            if (detail && detail->pss > 0)
+                ImGui::Text("%.0f MB (PSS %.0f / USS %.0f MB)",
+                    columns.memory_usage[row] / (1024.0f * 1024.0f),
+                    detail->pss / (1024.0f * 1024.0f),
+                    detail->uss / (1024.0f * 1024.0f));
+            else if (detail)
+                ImGui::Text("%.0f MB (USS %.0f MB)",
+                    columns.memory_usage[row] / (1024.0f * 1024.0f),
+                    detail->uss / (1024.0f * 1024.0f));
+            else
+                ImGui::Text("%.0f MB",
+                    columns.memory_usage[row] / (1024.0f * 1024.0f));
 
             ImGui::TableSetColumnIndex(8);
-            ImGui::PushID(row.pid);
+            ImGui::Text("%.1f MB/s",
+                columns.disk_read_usage[row] / (1000.0 * 1000.0));
+
+            ImGui::TableSetColumnIndex(9);
+            ImGui::Text("%.1f MB/s",
+                columns.disk_write_usage[row] / (1000.0 * 1000.0));
+
+            ImGui::TableSetColumnIndex(10);
+            ImGui::PushID(columns.pid[row]);
             if (ImGui::Button("Kill"))
             {
-                HANDLE process = OpenProcess(PROCESS_TERMINATE, FALSE, row.pid);
+#ifdef _WIN32
+                HANDLE process = OpenProcess(PROCESS_TERMINATE, FALSE, columns.pid[row]);
                 if (process)
                 {
                     TerminateProcess(process, 0);
                     CloseHandle(process);
                 }
+#else
+                kill(static_cast<pid_t>(columns.pid[row]), SIGKILL);
+#endif
             }
             ImGui::PopID();
         }
@@ -243,19 +248,30 @@ auto DashboardOverlay::Update() -> void
 {
     Overlay::Update();
 
-    constexpr auto UPDATE_INTERVAL = std::chrono::milliseconds(500);
-    auto now = std::chrono::steady_clock::now();
+    // Sampling is suspended while no overlay showing its results is visible.
+    // Only the per-process columns are drawn, cores and thermal are left to the controller overlay.
+    constexpr uint32_t rendered_groups = MetricGroup_Cpu | MetricGroup_Memory | MetricGroup_Gpu | MetricGroup_Disk;
+    metrics_subscription_.Update(this->IsVisible() ? rendered_groups : MetricGroup_None);
+    g_taskMonitor->SetSelectedPid(this->IsVisible() ? g_selected_pid : 0);
+    g_memory_details = g_taskMonitor->MemoryDetails();
 
-    if (now - g_last_update > UPDATE_INTERVAL)
+    // Sampling runs on the TaskMonitor thread, only re-sort the rows once a new sample is published.
+    auto snapshot = g_taskMonitor->Snapshot();
+    if (snapshot != g_snapshot)
     {
-        task_monitor_.Update();
+        g_snapshot = std::move(snapshot);
         g_rows_dirty = true;
-        g_last_update = now;
     }
 }
 
 
 auto DashboardOverlay::Destroy() -> void
 {
-    task_monitor_.Destroy();
+    metrics_subscription_.Update(MetricGroup_None);
+    g_taskMonitor->SetSelectedPid(0);
+
+    g_snapshot.reset();
+    g_memory_details.reset();
+    g_selected_pid = 0;
+    g_row_order.clear();
 }
\ No newline at end of file
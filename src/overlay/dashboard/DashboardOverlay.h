@@ -18,6 +18,6 @@ public:
     auto Update() -> void override;
     auto Destroy() -> void;
 private:
-    TaskMonitor task_monitor_;
     Settings settings_;
+    MetricSubscription metrics_subscription_;   // only held while the dashboard tab is shown
 };
\ No newline at end of file
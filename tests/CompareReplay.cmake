@@ -0,0 +1,23 @@
+# Replays CAPTURE through REPLAY (procfs_capture) and compares the digest of
+# every tick against EXPECTED, the timings at the end of each line are ignored.
+#
+#   cmake -DREPLAY=<procfs_capture> -DCAPTURE=<directory> -DEXPECTED=<file> -P CompareReplay.cmake
+
+execute_process(
+    COMMAND ${REPLAY} replay ${CAPTURE}
+    OUTPUT_VARIABLE output
+    RESULT_VARIABLE result
+)
+
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Replaying ${CAPTURE} failed:\n${output}")
+endif()
+
+string(REGEX MATCHALL "tick [0-9]+: [^\n]* digest [0-9a-f]+" digests "${output}")
+file(STRINGS ${EXPECTED} expected REGEX "^tick ")
+
+if (NOT digests STREQUAL expected)
+    string(REPLACE ";" "\n" digests "${digests}")
+    string(REPLACE ";" "\n" expected "${expected}")
+    message(FATAL_ERROR "Digests of ${CAPTURE} differ.\nExpected:\n${expected}\nReplayed:\n${digests}")
+endif()
@@ -0,0 +1,435 @@
+// Parses the fdinfo fixtures of every supported driver, then feeds them through
+// ProcfsProcessSampler on a synthetic /proc tree to check how duplicated clients
+// are accounted and the engine utilization computed over two ticks.
+//
+//   drm_fdinfo_test <fixture directory>
+//
+// Exits with 1 if any check failed, every failed check is printed.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <core/ProcessTable.hpp>
+#include <core/sampler/DrmFdinfo.hpp>
+#include <core/sampler/ProcfsProcessSampler.hpp>
+
+struct ExpectedEngine {
+    std::string_view name;
+    uint64_t busy_ns;
+    uint64_t cycles;
+    uint64_t total_cycles;
+    uint32_t capacity;
+    bool has_cycles;
+    uint32_t engine_type;   // GpuEngine_Flags
+};
+
+struct ExpectedFdinfo {
+    const char* file;
+    std::string_view driver;
+    std::string_view pdev;
+    uint64_t client_id;
+    size_t vram_usage;
+    size_t gtt_usage;
+    ExpectedEngine engines[DrmFdinfo_MaxEngines];
+    size_t engine_count;
+};
+
+constexpr size_t KiB = 1024;
+constexpr size_t MiB = 1024 * 1024;
+
+static const ExpectedFdinfo kFixtures[] = {
+    // Resident sizes are preferred over the legacy drm-memory-* keys printed next to them.
+    // amdgpu leaves out the engines a client never used.
+    {
+        "amdgpu.txt", "amdgpu", "0000:03:00.0", 52, 1536 * MiB, 8192 * KiB,
+        {
+            { "gfx", 1234567890, 0, 0, 1, false, GpuEngine_3D },
+            { "dma", 2500000, 0, 0, 1, false, GpuEngine_Copy },
+            { "enc", 4000000, 0, 0, 1, false, GpuEngine_VideoEncode },
+        },
+        3,
+    },
+    // Kernels before 6.4 only print drm-memory-*.
+    {
+        "amdgpu_legacy.txt", "amdgpu", "0000:03:00.0", 53, 262144 * KiB, 2048 * KiB,
+        {
+            { "gfx", 987654321, 0, 0, 1, false, GpuEngine_3D },
+            { "dec", 150000000, 0, 0, 1, false, GpuEngine_VideoDecode },
+        },
+        2,
+    },
+    // Stolen memory is neither device local nor system memory.
+    {
+        "i915.txt", "i915", "0000:00:02.0", 7, 384 * MiB, 34816 * KiB,
+        {
+            { "render", 25662044495, 0, 0, 1, false, GpuEngine_3D },
+            { "copy", 0, 0, 0, 1, false, GpuEngine_Copy },
+            { "video", 3000000, 0, 0, 2, false, GpuEngine_VideoCodec },
+            { "video-enhance", 0, 0, 0, 1, false, GpuEngine_Other },
+        },
+        4,
+    },
+    {
+        "xe.txt", "xe", "0000:00:02.0", 12, 200 * MiB, 20 * MiB,
+        {
+            { "rcs", 0, 28257900, 7655183225, 1, true, GpuEngine_3D },
+            { "bcs", 0, 0, 7655183225, 1, true, GpuEngine_Copy },
+            { "vcs", 0, 0, 7655183225, 2, true, GpuEngine_VideoCodec },
+            { "vecs", 0, 0, 7655183225, 2, true, GpuEngine_Other },
+            { "ccs", 0, 0, 7655183225, 4, true, GpuEngine_Compute },
+        },
+        5,
+    },
+};
+
+static int g_failures = 0;
+
+static auto check(bool condition, const char* context, const char* description) -> void
+{
+    if (!condition) {
+        printf("FAILED %s: %s\n", context, description);
+        ++g_failures;
+    }
+}
+
+static auto readFixture(const std::string& directory, const char* file) -> std::string
+{
+    std::string contents = {};
+
+    FILE* input = fopen((directory + "/" + file).c_str(), "r");
+    if (input == nullptr)
+        return contents;
+
+    char buffer[4096] = {};
+    size_t length = 0;
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0)
+        contents.append(buffer, length);
+    fclose(input);
+
+    return contents;
+}
+
+static auto writeFile(const std::string& path, std::string_view contents) -> void
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return;
+
+    [[maybe_unused]] ssize_t written = write(fd, contents.data(), contents.size());
+    close(fd);
+}
+
+static auto removeTree(const char* root) -> void
+{
+    nftw(root, [](const char* path, const struct stat*, int, FTW*) { return remove(path); }, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static auto testParser(const std::string& directory) -> void
+{
+    for (const ExpectedFdinfo& expected : kFixtures) {
+        const std::string text = readFixture(directory, expected.file);
+        check(!text.empty(), expected.file, "fixture is missing");
+
+        DrmFdinfo fdinfo = {};
+        check(ParseDrmFdinfo(text, fdinfo), expected.file, "not parsed as a DRM client");
+        check(fdinfo.driver == expected.driver, expected.file, "driver");
+        check(fdinfo.pdev == expected.pdev, expected.file, "pdev");
+        check(fdinfo.client_id == expected.client_id, expected.file, "client id");
+        check(fdinfo.vram_usage == expected.vram_usage, expected.file, "vram usage");
+        check(fdinfo.gtt_usage == expected.gtt_usage, expected.file, "gtt usage");
+        check(fdinfo.engine_count == expected.engine_count, expected.file, "engine count");
+
+        for (size_t i = 0; i < std::min(fdinfo.engine_count, expected.engine_count); ++i) {
+            const DrmEngineUsage& engine = fdinfo.engines[i];
+            const ExpectedEngine& expected_engine = expected.engines[i];
+            const std::string context = std::string(expected.file) + " engine " + std::string(expected_engine.name);
+
+            check(engine.name == expected_engine.name, context.c_str(), "name");
+            check(engine.busy_ns == expected_engine.busy_ns, context.c_str(), "busy ns");
+            check(engine.cycles == expected_engine.cycles, context.c_str(), "cycles");
+            check(engine.total_cycles == expected_engine.total_cycles, context.c_str(), "total cycles");
+            check(engine.capacity == expected_engine.capacity, context.c_str(), "capacity");
+            check(engine.has_cycles == expected_engine.has_cycles, context.c_str(), "has cycles");
+            check(DecodeDrmEngineType(engine.name) == expected_engine.engine_type, context.c_str(), "engine type");
+        }
+    }
+
+    DrmFdinfo fdinfo = {};
+    check(!ParseDrmFdinfo(readFixture(directory, "socket.txt"), fdinfo), "socket.txt", "parsed as a DRM client");
+}
+
+// Synthetic /proc and /sys with an amdgpu and an Intel adapter, DRM clients are added from the fixtures.
+class SyntheticSystem {
+public:
+    explicit SyntheticSystem(std::string directory)
+    {
+        directory_ = std::move(directory);
+        root_ = {};
+    }
+
+    ~SyntheticSystem()
+    {
+        if (!root_.empty())
+            removeTree(root_.c_str());
+    }
+
+    auto Create() -> bool
+    {
+        char root[] = "/tmp/drm_fdinfo_test.XXXXXX";
+        if (mkdtemp(root) == nullptr)
+            return false;
+        root_ = root;
+
+        mkdir((root_ + "/proc").c_str(), 0755);
+        mkdir((root_ + "/sys").c_str(), 0755);
+        mkdir((root_ + "/sys/class").c_str(), 0755);
+        mkdir((root_ + "/sys/class/drm").c_str(), 0755);
+        mkdir((root_ + "/sys/devices").c_str(), 0755);
+        addAdapter(0, "0000:03:00.0", "amdgpu");
+        addAdapter(1, "0000:00:02.0", "i915");
+        writeFile(root_ + "/sys/devices/0000:03:00.0/mem_info_vram_total", "17163091968\n");
+        writeFile(root_ + "/sys/devices/0000:03:00.0/mem_info_gtt_total", "33554432000\n");
+        return true;
+    }
+
+    [[nodiscard]] auto Root() const -> const std::string& { return root_; }
+
+    auto AddProcess(uint32_t pid) -> void
+    {
+        const std::string process = root_ + "/proc/" + std::to_string(pid);
+        mkdir(process.c_str(), 0755);
+        mkdir((process + "/fd").c_str(), 0755);
+        mkdir((process + "/fdinfo").c_str(), 0755);
+
+        char buffer[512] = {};
+        writeFile(process + "/cgroup", "0::/user.slice\n");
+        writeFile(process + "/statm", "10000 1000 2000 100 0 3000 0\n");
+        snprintf(buffer, sizeof(buffer),
+            "%u (process-%u) S 1 %u %u 0 -1 4194560 100 0 0 0 0 0 0 0 20 0 1 0 %u 10000000 1000 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0\n",
+            pid, pid, pid, pid, pid);
+        writeFile(process + "/stat", buffer);
+    }
+
+    // Also used to replace the fdinfo of a descriptor for the next tick.
+    auto SetClient(uint32_t pid, int fd, const char* fixture) -> void
+    {
+        const std::string process = root_ + "/proc/" + std::to_string(pid);
+        symlink("/dev/dri/renderD128", (process + "/fd/" + std::to_string(fd)).c_str());
+        writeFile(process + "/fdinfo/" + std::to_string(fd), readFixture(directory_, fixture));
+    }
+private:
+    auto addAdapter(uint32_t card, const char* slot, const char* driver) -> void
+    {
+        const std::string device = root_ + "/sys/devices/" + slot;
+        const std::string card_path = root_ + "/sys/class/drm/card" + std::to_string(card);
+        mkdir(device.c_str(), 0755);
+        mkdir(card_path.c_str(), 0755);
+        symlink((std::string("../../../devices/") + slot).c_str(), (card_path + "/device").c_str());
+        symlink((std::string("../../../bus/pci/drivers/") + driver).c_str(), (device + "/driver").c_str());
+    }
+
+    std::string directory_;
+    std::string root_;
+};
+
+static auto createSampler(const std::string& root, const uint64_t& clock) -> ProcfsProcessSampler
+{
+    ProcfsSource source = {};
+    source.root = root;
+    source.clock = [&clock] { return clock; };
+    source.reopen_files = true;
+    source.clock_ticks = 100;
+    source.page_size = 4096;
+    source.processor_count = 4;
+    source.system_memory = 16ull * 1024 * 1024 * 1024;
+
+    return ProcfsProcessSampler(std::move(source));
+}
+
+static auto sample(ProcfsProcessSampler& sampler, ProcessTable& table) -> void
+{
+    table.BeginTick();
+    sampler.Sample(table, MetricGroup_Gpu);
+    table.EndTick();
+}
+
+// Engines of every GPU of the process with engine_type, and the sum of their utilization.
+static auto engineUsage(const ProcessInfo* process, uint32_t engine_type, size_t& engine_count) -> float
+{
+    float utilization = 0.0f;
+    engine_count = 0;
+
+    if (process == nullptr)
+        return utilization;
+
+    for (const auto& [gpu_index, gpu] : process->gpus) {
+        for (const auto& [engine_index, engine] : gpu.engines) {
+            if (engine.engine_type == engine_type) {
+                utilization += engine.utilization_percentage;
+                ++engine_count;
+            }
+        }
+    }
+
+    return utilization;
+}
+
+static auto checkEngine(const ProcessInfo* process, uint32_t engine_type, float expected, const char* context, const char* description) -> void
+{
+    size_t engine_count = 0;
+    const float utilization = engineUsage(process, engine_type, engine_count);
+    check(engine_count == 1 && std::abs(utilization - expected) < 0.01f, context, description);
+}
+
+// Descriptors sharing a client, duplicated within a process or inherited by another one, are accounted once.
+static auto testDuplicateClients(const std::string& directory) -> void
+{
+    SyntheticSystem system(directory);
+    if (!system.Create()) {
+        check(false, "duplicate clients", "mkdtemp failed");
+        return;
+    }
+
+    // 1000 opened client 52 twice, 1001 inherited it and opened client 53 of its own.
+    system.AddProcess(1000);
+    system.AddProcess(1001);
+    system.SetClient(1000, 10, "amdgpu.txt");
+    system.SetClient(1000, 11, "amdgpu.txt");
+    system.SetClient(1001, 5, "amdgpu.txt");
+    system.SetClient(1001, 6, "amdgpu_legacy.txt");
+
+    uint64_t clock = 0;
+    ProcfsProcessSampler sampler = createSampler(system.Root(), clock);
+    check(sampler.Initialize(), "duplicate clients", "sampler failed to initialize");
+
+    ProcessTable table;
+    sample(sampler, table);
+    sampler.Destroy();
+
+    const ProcessInfo* first = table.Find(1000);
+    const ProcessInfo* second = table.Find(1001);
+    check(first != nullptr && first->gpus.size() == 1, "duplicate clients", "client 52 is not accounted to 1000");
+    check(second != nullptr && second->gpus.size() == 1, "duplicate clients", "client 53 is not accounted to 1001");
+
+    if (first != nullptr && first->gpus.size() == 1) {
+        const GpuInfo& gpu = first->gpus.begin()->second;
+        check(gpu.memory.dedicated_vram_usage == 1536 * MiB, "duplicate clients", "vram of 1000 counts client 52 more than once");
+        check(gpu.memory.shared_vram_usage == 8192 * KiB, "duplicate clients", "gtt of 1000 counts client 52 more than once");
+    }
+
+    if (second != nullptr && second->gpus.size() == 1) {
+        const GpuInfo& gpu = second->gpus.begin()->second;
+        check(gpu.memory.dedicated_vram_usage == 262144 * KiB, "duplicate clients", "vram of 1001 counts the inherited client 52");
+        check(gpu.memory.shared_vram_usage == 2048 * KiB, "duplicate clients", "gtt of 1001 counts the inherited client 52");
+    }
+}
+
+// Two ticks one second apart, the <fixture>.1.txt files hold the counters of the second one.
+static auto testUtilization(const std::string& directory) -> void
+{
+    SyntheticSystem system(directory);
+    if (!system.Create()) {
+        check(false, "utilization", "mkdtemp failed");
+        return;
+    }
+
+    // 2002 holds two amdgpu clients listing different engines, 2003 one that used a new engine between the ticks.
+    struct Client {
+        uint32_t pid;
+        int fd;
+        const char* first;
+        const char* second;
+    };
+    const Client clients[] = {
+        { 2000, 4, "i915.txt", "i915.1.txt" },
+        { 2001, 4, "xe.txt", "xe.1.txt" },
+        { 2002, 4, "amdgpu.txt", "amdgpu.1.txt" },
+        { 2002, 5, "amdgpu_legacy.txt", "amdgpu_legacy.1.txt" },
+        { 2003, 4, "amdgpu_grow.txt", "amdgpu_grow.1.txt" },
+    };
+
+    for (uint32_t pid : { 2000u, 2001u, 2002u, 2003u })
+        system.AddProcess(pid);
+    for (const Client& client : clients)
+        system.SetClient(client.pid, client.fd, client.first);
+
+    uint64_t clock = 1'000'000'000;
+    ProcfsProcessSampler sampler = createSampler(system.Root(), clock);
+    check(sampler.Initialize(), "utilization", "sampler failed to initialize");
+
+    ProcessTable table;
+    sample(sampler, table);
+
+    for (const Client& client : clients)
+        system.SetClient(client.pid, client.fd, client.second);
+    clock += 1'000'000'000;
+    sample(sampler, table);
+    sampler.Destroy();
+
+    // busy_ns per second, video has a capacity of 2.
+    const ProcessInfo* i915 = table.Find(2000);
+    checkEngine(i915, GpuEngine_3D, 50.0f, "i915", "render busy 500 ms of 1 s");
+    checkEngine(i915, GpuEngine_Copy, 0.0f, "i915", "copy idle");
+    checkEngine(i915, GpuEngine_VideoCodec, 30.0f, "i915", "video busy 600 ms over 2 instances");
+
+    // Busy cycles against total cycles, scaled by the engine capacity.
+    const ProcessInfo* xe = table.Find(2001);
+    checkEngine(xe, GpuEngine_3D, 25.0f, "xe", "rcs busy a quarter of the cycles");
+    checkEngine(xe, GpuEngine_VideoCodec, 50.0f, "xe", "vcs busy every cycle of 1 of 2 instances");
+    checkEngine(xe, GpuEngine_Compute, 10.0f, "xe", "ccs busy 40 % of the cycles of 1 of 4 instances");
+    checkEngine(xe, GpuEngine_Copy, 0.0f, "xe", "bcs idle");
+
+    // Summed per engine, not per position in the fdinfo of each client.
+    const ProcessInfo* amdgpu = table.Find(2002);
+    checkEngine(amdgpu, GpuEngine_3D, 50.0f, "amdgpu clients", "gfx of both clients");
+    checkEngine(amdgpu, GpuEngine_Copy, 5.0f, "amdgpu clients", "dma of client 52 only");
+    checkEngine(amdgpu, GpuEngine_VideoEncode, 10.0f, "amdgpu clients", "enc of client 52 only");
+    checkEngine(amdgpu, GpuEngine_VideoDecode, 40.0f, "amdgpu clients", "dec of client 53 only");
+
+    // The counters of a changed engine list are not comparable to the last tick.
+    const ProcessInfo* grown = table.Find(2003);
+    checkEngine(grown, GpuEngine_3D, 0.0f, "changed engine list", "gfx has no baseline");
+    checkEngine(grown, GpuEngine_VideoDecode, 0.0f, "changed engine list", "dec has no baseline");
+
+    // Engine indices belong to the engine name, the same for every process.
+    uint32_t gfx_index[2] = { UINT32_MAX, UINT32_MAX };
+    for (const ProcessInfo* process : { amdgpu, grown }) {
+        if (process == nullptr)
+            continue;
+        for (const auto& [gpu_index, gpu] : process->gpus) {
+            for (const auto& [engine_index, engine] : gpu.engines) {
+                check(engine.engine_index == engine_index, "engine index", "engine_index differs from its key");
+                if (engine.engine_type == GpuEngine_3D)
+                    gfx_index[process == amdgpu ? 0 : 1] = engine.engine_index;
+            }
+        }
+    }
+    check(gfx_index[0] != UINT32_MAX && gfx_index[0] == gfx_index[1], "engine index", "gfx has a different index per process");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("usage: %s <fixture directory>\n", argv[0]);
+        return 2;
+    }
+
+    testParser(argv[1]);
+    testDuplicateClients(argv[1]);
+    testUtilization(argv[1]);
+
+    if (g_failures > 0)
+        return 1;
+
+    printf("All checks passed.\n");
+    return 0;
+}
\ No newline at end of file